@@ -0,0 +1,91 @@
+// 环境光、方向光、点光的结构体和光照计算，被 lit.frag 包含
+// 灯光数量由关键字 DIRECTIONAL_LIGHTS / POINT_LIGHTS 决定，数量为 0 的灯光不会生成任何代码
+
+#ifndef DIRECTIONAL_LIGHTS
+#define DIRECTIONAL_LIGHTS 0
+#endif
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS 0
+#endif
+
+//环境光
+struct Ambient {
+    vec3  color;//环境光 alignment:12 offset:0
+    float intensity;//环境光强度 alignment:4 offset:12
+};
+
+layout(std140) uniform AmbientBlock {
+    Ambient data;
+}u_ambient;
+
+//方向光
+struct DirectionalLight {
+    vec3  dir;//方向 alignment:12 offset:0
+    vec3  color;//颜色 alignment:12 offset:16
+    float intensity;//强度 alignment:4 offset:28
+};
+
+//点光
+struct PointLight {
+    vec3  pos;//位置 alignment:16 offset:0
+    vec3  color;//颜色 alignment:12 offset:16
+    float intensity;//强度 alignment:4 offset:28
+
+    float constant;//点光衰减常数项 alignment:4 offset:32
+    float linear;//点光衰减一次项 alignment:4 offset:36
+    float quadratic;//点光衰减二次项 alignment:4 offset:40
+};
+
+#if DIRECTIONAL_LIGHTS > 0
+layout(std140) uniform DirectionalLightBlock {
+    DirectionalLight data[DIRECTIONAL_LIGHTS];
+}u_directional_light_array;
+#endif
+
+#if POINT_LIGHTS > 0
+layout(std140) uniform PointLightBlock {
+    PointLight data[POINT_LIGHTS];
+}u_point_light_array;
+#endif
+
+//一盏灯的漫反射和高光，light_dir 指向灯光
+void accumulateLight(vec3 light_dir, vec3 light_color, float light_intensity, vec3 normal, vec3 view_dir,
+    float shininess, float specular_intensity, inout vec3 diffuse, inout vec3 specular)
+{
+    float diffuse_intensity = max(dot(normal, light_dir), 0.0);
+    diffuse += light_color * diffuse_intensity * light_intensity;
+
+    vec3 reflect_dir = reflect(-light_dir, normal);
+    float spec = pow(max(dot(view_dir, reflect_dir), 0.0), shininess);
+    specular += light_color * spec * specular_intensity;
+}
+
+//所有灯光叠加的漫反射和高光，乘以漫反射颜色前的结果
+void accumulateLights(vec3 frag_pos, vec3 normal, vec3 view_dir, float shininess, float specular_intensity,
+    out vec3 diffuse, out vec3 specular)
+{
+    diffuse = vec3(0.0);
+    specular = vec3(0.0);
+#if DIRECTIONAL_LIGHTS > 0
+    for (int i = 0; i < DIRECTIONAL_LIGHTS; i++)
+    {
+        DirectionalLight light = u_directional_light_array.data[i];
+        accumulateLight(normalize(-light.dir), light.color, light.intensity, normal, view_dir,
+            shininess, specular_intensity, diffuse, specular);
+    }
+#endif
+#if POINT_LIGHTS > 0
+    for (int i = 0; i < POINT_LIGHTS; i++)
+    {
+        PointLight light = u_point_light_array.data[i];
+        //点光源衰减
+        float distance = length(light.pos - frag_pos);
+        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+        vec3 d = vec3(0.0), s = vec3(0.0);
+        accumulateLight(normalize(light.pos - frag_pos), light.color, light.intensity, normal, view_dir,
+            shininess, specular_intensity, d, s);
+        diffuse += d * attenuation;
+        specular += s * attenuation;
+    }
+#endif
+}
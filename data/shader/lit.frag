@@ -0,0 +1,63 @@
+#version 330 core
+#pragma keywords DIRECTIONAL_LIGHTS POINT_LIGHTS SHADOWS SPECULAR_MAP QUANTIZED_POSITION OCT_NORMAL
+
+//DIRECTIONAL_LIGHTS N / POINT_LIGHTS N: 灯光数量，默认 0 只有环境光
+//SHADOWS: 采样 u_depth_texture 阴影贴图
+//SPECULAR_MAP: 高光强度取自 u_specular_texture，否则用 u_specular_highlight_intensity
+
+#include "include/lighting.glsl"
+
+uniform sampler2D u_diffuse_texture;//颜色纹理
+
+uniform vec3 u_view_pos;
+uniform float u_specular_highlight_shininess;//物体反光度，越高反光能力越强，高光点越小。
+#ifdef SPECULAR_MAP
+uniform sampler2D u_specular_texture;//高光贴图
+#else
+uniform float u_specular_highlight_intensity;//镜面高光强度
+#endif
+
+#ifdef SHADOWS
+uniform sampler2D u_depth_texture;
+in vec4 v_shadow_camera_gl_Position;
+
+float ShadowCalculation(vec4 shadow_camera_gl_Position)
+{
+    vec3 proj_coords = shadow_camera_gl_Position.xyz / shadow_camera_gl_Position.w;
+    proj_coords = proj_coords * 0.5 + 0.5;
+    float closest_depth = texture(u_depth_texture, proj_coords.xy).r;
+    float current_depth = proj_coords.z;
+    float bias = 0.005;
+    return current_depth - bias > closest_depth ? 1.0 : 0.0;
+}
+#endif
+
+in vec4 v_color;//顶点色
+in vec2 v_uv;
+in vec3 v_normal;
+in vec3 v_frag_pos;
+
+layout(location = 0) out vec4 o_fragColor;
+void main()
+{
+    vec3 albedo = texture(u_diffuse_texture, v_uv).rgb;
+    vec3 ambient_color = u_ambient.data.color * u_ambient.data.intensity * albedo;
+
+#if DIRECTIONAL_LIGHTS > 0 || POINT_LIGHTS > 0
+#ifdef SPECULAR_MAP
+    float specular_intensity = texture(u_specular_texture, v_uv).r;//从纹理中获取高光强度
+#else
+    float specular_intensity = u_specular_highlight_intensity;
+#endif
+    vec3 diffuse, specular;
+    accumulateLights(v_frag_pos, normalize(v_normal), normalize(u_view_pos - v_frag_pos),
+        u_specular_highlight_shininess, specular_intensity, diffuse, specular);
+    vec3 direct = (diffuse + specular) * albedo;
+#ifdef SHADOWS
+    direct *= 1.0 - ShadowCalculation(v_shadow_camera_gl_Position);
+#endif
+    o_fragColor = vec4(ambient_color + direct, 1.0);
+#else
+    o_fragColor = vec4(ambient_color, 1.0);
+#endif
+}
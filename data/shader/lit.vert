@@ -0,0 +1,68 @@
+#version 330 core
+#pragma keywords DIRECTIONAL_LIGHTS POINT_LIGHTS SHADOWS SPECULAR_MAP QUANTIZED_POSITION OCT_NORMAL
+
+//render/VertexFormat 压缩的顶点，两个关键字可以单独使用也可以一起用
+//QUANTIZED_POSITION: 位置量化到包围盒 (VC_POSITION_QUANTIZED)
+//OCT_NORMAL: 法线八面体编码 (VC_NORMAL_OCT)
+
+uniform mat4 u_model;
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+#ifdef QUANTIZED_POSITION
+uniform vec3 u_pos_offset;//反量化 pos = offset + a_pos * scale
+uniform vec3 u_pos_scale;
+#endif
+
+#ifdef SHADOWS
+uniform mat4 u_shadow_camera_view;
+uniform mat4 u_shadow_camera_projection;
+#endif
+
+layout(location = 0) in  vec3 a_pos;
+layout(location = 1) in  vec4 a_color;
+layout(location = 2) in  vec2 a_uv;
+#ifdef OCT_NORMAL
+layout(location = 3) in  vec2 a_normal;//八面体编码 snorm16
+#else
+layout(location = 3) in  vec3 a_normal;
+#endif
+
+out vec4 v_color;
+out vec2 v_uv;
+out vec3 v_normal;
+out vec3 v_frag_pos;
+#ifdef SHADOWS
+out vec4 v_shadow_camera_gl_Position;
+#endif
+
+#ifdef OCT_NORMAL
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+#endif
+
+void main()
+{
+#ifdef QUANTIZED_POSITION
+    vec4 pos = vec4(u_pos_offset + a_pos * u_pos_scale, 1.0);
+#else
+    vec4 pos = vec4(a_pos, 1.0);
+#endif
+#ifdef OCT_NORMAL
+    v_normal = octDecode(a_normal);
+#else
+    v_normal = a_normal;
+#endif
+    gl_Position = u_projection * u_view * u_model * pos;
+    v_color = a_color;
+    v_uv = a_uv;
+    v_frag_pos = vec3(u_model * pos);
+#ifdef SHADOWS
+    v_shadow_camera_gl_Position = u_shadow_camera_projection * u_shadow_camera_view * u_model * pos;
+#endif
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "render/ShaderSource.h"
+
+using namespace CGE;
+
+// Build step behind CGE_EMBED_SHADERS: checks every file under the shader
+// directory and writes a translation unit holding each vertex/fragment stage
+// with its includes resolved and comments stripped, plus the hash that keys
+// the program-binary cache. Runs in every build, so a broken shader fails the
+// build with file:line instead of at startup.
+
+static bool endsWith(const std::string& s, const char* suffix)
+{
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static bool isStage(const std::string& name)
+{
+    return endsWith(name, ".vert") || endsWith(name, ".vs") || endsWith(name, ".frag") || endsWith(name, ".fs");
+}
+
+// every file under dir, relative to root
+static void listFiles(const std::string& root, const std::string& dir, std::vector<std::string>* files)
+{
+    DIR* handle = opendir((root + dir).c_str());
+    if (!handle) return;
+    while (dirent* e = readdir(handle))
+    {
+        std::string name = e->d_name;
+        if (name[0] == '.') continue;
+        struct stat info;
+        if (stat((root + dir + name).c_str(), &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) listFiles(root, dir + name + "/", files);
+        else files->push_back(dir + name);
+    }
+    closedir(handle);
+}
+
+// one string literal per line, so the generated file diffs and reads like the shader
+static std::string literal(const std::string& source)
+{
+    std::string out = "    \"";
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        unsigned char c = source[i];
+        if (c == '\n')
+            out += i + 1 < source.size() ? "\\n\"\n    \"" : "\\n";
+        else if (c == '"' || c == '\\')
+            (out += '\\') += c;
+        else if (c < 0x20 || c >= 0x7f)
+        {
+            // octal, a hex escape would swallow the following characters
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\%03o", c);
+            out += escape;
+        }
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        std::cout << "ShaderEmbed SHADER_DIR OUTPUT.cpp" << std::endl;
+        return 1;
+    }
+    std::string root = argv[1];
+    std::string output = argv[2];
+    if (!root.empty() && root.back() != '/') root += '/';
+
+    std::vector<std::string> files;
+    listFiles(root, std::string(), &files);
+    std::sort(files.begin(), files.end());
+    if (files.empty())
+    {
+        std::cout << "ShaderEmbed: no shaders in " << root << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    std::vector<std::string> names, sources;
+    for (const std::string& file : files)
+    {
+        std::string text;
+        if (!readShaderFile(root + file, &text))
+        {
+            std::cout << root << file << ": cannot read" << std::endl;
+            ok = false;
+            continue;
+        }
+        // checked as written, so the line numbers are the file's own
+        bool stage = isStage(file);
+        ok = validateShader(stripShaderComments(text), root + file, stage) && ok;
+        if (!stage) continue;
+
+        // vertex shaders need a fragment stage, their own or their base name's
+        std::string stem = file.substr(0, file.find_last_of('.'));
+        if ((endsWith(file, ".vert") || endsWith(file, ".vs")) && findShaderStage(root + stem, true).empty())
+        {
+            std::cout << root << file << ": no fragment shader" << std::endl;
+            ok = false;
+        }
+
+        std::vector<std::string> keywords, included;
+        std::string source;
+        if (!preprocessShader(root + file, &source, &keywords, included))
+        {
+            ok = false;
+            continue;
+        }
+        names.push_back(file);
+        sources.push_back(stripShaderComments(source));
+    }
+    if (!ok) return 1;
+
+    std::string text = "// generated by ShaderEmbed from " + root + ", do not edit\n"
+        "#include \"render/ShaderSource.h\"\n\nnamespace CGE\n{\n\n";
+    for (size_t i = 0; i < names.size(); i++)
+        text += "// " + names[i] + "\nstatic constexpr char kShader" + std::to_string(i) + "[] =\n" +
+            literal(sources[i]) + ";\n\n";
+    text += "extern const EmbeddedShader kEmbeddedShaders[] =\n{\n";
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        char hash[32];
+        snprintf(hash, sizeof(hash), "0x%016llxull", (unsigned long long)shaderHash(sources[i]));
+        text += "    { \"" + names[i] + "\", kShader" + std::to_string(i) + ", sizeof(kShader" + std::to_string(i) +
+            ") - 1, " + hash + " },\n";
+    }
+    text += "};\nextern const size_t kEmbeddedShaderCount = " + std::to_string(names.size()) + ";\n\n}\n";
+
+    // an unchanged file keeps its timestamp, GamEng does not relink for a comment edit
+    std::string previous;
+    if (readShaderFile(output, &previous) && previous == text) return 0;
+    FILE* file = fopen(output.c_str(), "wb");
+    if (!file || fwrite(text.data(), 1, text.size(), file) != text.size())
+    {
+        std::cout << "ShaderEmbed: cannot write " << output << std::endl;
+        if (file) fclose(file);
+        return 1;
+    }
+    fclose(file);
+    printf("ShaderEmbed: %zu stages from %zu files\n", names.size(), files.size());
+    return 0;
+}
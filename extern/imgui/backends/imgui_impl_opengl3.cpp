@@ -132,6 +132,9 @@
 #else
 #include <GLES3/gl3.h>          // Use GL ES 3
 #endif
+#elif defined(IMGUI_IMPL_OPENGL_LOADER_GLAD)
+// CGE: go through the engine's glad pointers, so GL capture records the UI as well
+#include <glad/gl.h>
 #elif !defined(IMGUI_IMPL_OPENGL_LOADER_CUSTOM)
 // Modern desktop OpenGL doesn't have a standard portable header file to load OpenGL function pointers.
 // Helper libraries are often used for this purpose! Here we are using our own minimal custom loader based on gl3w.
@@ -206,6 +209,10 @@ struct ImGui_ImplOpenGL3_Data
     GLsizeiptr      IndexBufferSize;
     bool            HasClipOrigin;
     bool            UseBufferSubData;
+    GLuint          StreamBuffer;            // CGE: engine streaming buffer, see ImGui_ImplOpenGL3_SetStreamUpload()
+    ImGui_ImplOpenGL3_StreamUploadFn StreamUpload;
+    void*           StreamUserData;
+    bool            StreamFailed;            // CGE: upload ran out of space, glBufferData() for the rest of the frame
 
     ImGui_ImplOpenGL3_Data() { memset((void*)this, 0, sizeof(*this)); }
 };
@@ -252,7 +259,7 @@ bool    ImGui_ImplOpenGL3_Init(const char* glsl_version)
     IM_ASSERT(io.BackendRendererUserData == nullptr && "Already initialized a renderer backend!");
 
     // Initialize our loader
-#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && !defined(IMGUI_IMPL_OPENGL_LOADER_CUSTOM)
+#if !defined(IMGUI_IMPL_OPENGL_ES2) && !defined(IMGUI_IMPL_OPENGL_ES3) && !defined(IMGUI_IMPL_OPENGL_LOADER_CUSTOM) && !defined(IMGUI_IMPL_OPENGL_LOADER_GLAD)
     if (imgl3wInit() != 0)
     {
         fprintf(stderr, "Failed to initialize OpenGL loader!\n");
@@ -429,8 +436,10 @@ static void ImGui_ImplOpenGL3_SetupRenderState(ImDrawData* draw_data, int fb_wid
 #endif
 
     // Bind vertex/index buffers and setup attributes for ImDrawVert
-    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bd->VboHandle));
-    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bd->ElementsHandle));
+    // CGE: both come from the streaming buffer when it is in use
+    const bool use_stream = bd->StreamUpload && !bd->StreamFailed && bd->GlVersion >= 320;
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, use_stream ? bd->StreamBuffer : bd->VboHandle));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, use_stream ? bd->StreamBuffer : bd->ElementsHandle));
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxPos));
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxUV));
     GL_CALL(glEnableVertexAttribArray(bd->AttribLocationVtxColor));
@@ -498,6 +507,7 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
 #ifdef IMGUI_IMPL_OPENGL_USE_VERTEX_ARRAY
     GL_CALL(glGenVertexArrays(1, &vertex_array_object));
 #endif
+    bd->StreamFailed = false;
     ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
 
     // Will project scissor/clipping rectangles into framebuffer space
@@ -519,7 +529,31 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
         // - See https://github.com/ocornut/imgui/issues/4468 and please report any corruption issues.
         const GLsizeiptr vtx_buffer_size = (GLsizeiptr)cmd_list->VtxBuffer.Size * (int)sizeof(ImDrawVert);
         const GLsizeiptr idx_buffer_size = (GLsizeiptr)cmd_list->IdxBuffer.Size * (int)sizeof(ImDrawIdx);
-        if (bd->UseBufferSubData)
+        // CGE: sub-allocate from the streaming buffer, draws are offset by base vertex and index byte offset
+        GLint stream_base_vertex = 0;
+        intptr_t stream_idx_offset = 0;
+        bool streamed = false;
+        if (bd->StreamUpload && !bd->StreamFailed && bd->GlVersion >= 320)
+        {
+            long long vtx_offset = bd->StreamUpload(cmd_list->VtxBuffer.Data, vtx_buffer_size, sizeof(ImDrawVert), bd->StreamUserData);
+            long long idx_offset = vtx_offset < 0 ? -1 : bd->StreamUpload(cmd_list->IdxBuffer.Data, idx_buffer_size, sizeof(ImDrawIdx), bd->StreamUserData);
+            if (idx_offset >= 0)
+            {
+                stream_base_vertex = (GLint)(vtx_offset / (long long)sizeof(ImDrawVert));
+                stream_idx_offset = (intptr_t)idx_offset;
+                streamed = true;
+            }
+            else
+            {
+                bd->StreamFailed = true;
+                ImGui_ImplOpenGL3_SetupRenderState(draw_data, fb_width, fb_height, vertex_array_object);
+            }
+        }
+        if (streamed)
+        {
+            // CGE: data already lives in the streaming buffer
+        }
+        else if (bd->UseBufferSubData)
         {
             if (bd->VertexBufferSize < vtx_buffer_size)
             {
@@ -567,7 +601,7 @@ void    ImGui_ImplOpenGL3_RenderDrawData(ImDrawData* draw_data)
                 GL_CALL(glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->GetTexID()));
 #ifdef IMGUI_IMPL_OPENGL_MAY_HAVE_VTX_OFFSET
                 if (bd->GlVersion >= 320)
-                    GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx)), (GLint)pcmd->VtxOffset));
+                    GL_CALL(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(stream_idx_offset + (intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))), (GLint)pcmd->VtxOffset + stream_base_vertex));
                 else
 #endif
                 GL_CALL(glDrawElements(GL_TRIANGLES, (GLsizei)pcmd->ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, (void*)(intptr_t)(pcmd->IdxOffset * sizeof(ImDrawIdx))));
@@ -699,6 +733,14 @@ static bool CheckProgram(GLuint handle, const char* desc)
     return (GLboolean)status == GL_TRUE;
 }
 
+void    ImGui_ImplOpenGL3_SetStreamUpload(unsigned int buffer, ImGui_ImplOpenGL3_StreamUploadFn upload, void* user_data)
+{
+    ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
+    bd->StreamBuffer = buffer;
+    bd->StreamUpload = buffer ? upload : nullptr;
+    bd->StreamUserData = user_data;
+}
+
 bool    ImGui_ImplOpenGL3_CreateDeviceObjects()
 {
     ImGui_ImplOpenGL3_Data* bd = ImGui_ImplOpenGL3_GetBackendData();
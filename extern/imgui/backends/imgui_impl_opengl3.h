@@ -33,6 +33,12 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// CGE: stream vertex/index data through an engine owned buffer instead of glBufferData() per draw list.
+// 'upload' copies 'size' bytes into 'buffer' and returns the byte offset, or -1 to fall back for the rest of the frame.
+// Needs glDrawElementsBaseVertex() (GL 3.2+), ignored otherwise. Pass 0/nullptr to disable.
+typedef long long (*ImGui_ImplOpenGL3_StreamUploadFn)(const void* data, long long size, long long alignment, void* user_data);
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetStreamUpload(unsigned int buffer, ImGui_ImplOpenGL3_StreamUploadFn upload, void* user_data);
+
 // Specific OpenGL ES versions
 //#define IMGUI_IMPL_OPENGL_ES2     // Auto-detected on Emscripten
 //#define IMGUI_IMPL_OPENGL_ES3     // Auto-detected on iOS/Android
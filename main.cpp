@@ -4,7 +4,11 @@ using namespace CGE;
 
 int main(int argc, char** argv)
 {
-    MiniGL widget;
+    MiniGLOptions options = MiniGLOptions::parse(argc, argv);
+    if (options.cull_bench)
+        return benchmarkCulling(options.cull_bench, options.threads);
+    MiniGL widget(options);
+    if (!widget.valid()) return 1;
     widget.mainLoop();
     return 0;
-}
\ No newline at end of file
+}
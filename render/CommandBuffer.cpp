@@ -0,0 +1,42 @@
+#include "render/CommandBuffer.h"
+#include "render/Profiler.h"
+
+using namespace CGE;
+
+void CommandBuffer::append(const CommandBuffer& other)
+{
+    uint32_t base = (uint32_t)uniforms.size();
+    uniforms.insert(uniforms.end(), other.uniforms.begin(), other.uniforms.end());
+    size_t first = packets.size();
+    packets.insert(packets.end(), other.packets.begin(), other.packets.end());
+    for (size_t i = first; i < packets.size(); i++) packets[i].model += base;
+}
+
+void ParallelRecorder::record(CGE_UTIL::ThreadPool& pool, size_t count, const RecordFn& fn, CommandBuffer& out)
+{
+    if (count == 0) return;
+    size_t chunks = (count + _chunk - 1) / _chunk;
+    if (_buffers.size() < chunks) _buffers.resize(chunks);
+
+    {
+        CGE_PROFILE_SCOPE("Record");
+        pool.parallelFor(count, _chunk, [&](size_t begin, size_t end) {
+            CGE_PROFILE_SCOPE("RecordChunk");
+            CommandBuffer& buffer = _buffers[begin / _chunk];
+            buffer.clear();
+            fn(buffer, begin, end);
+        });
+    }
+
+    CGE_PROFILE_SCOPE("Merge");
+    size_t packets = out.packets.size(), floats = out.uniforms.size();
+    for (size_t i = 0; i < chunks; i++)
+    {
+        packets += _buffers[i].packets.size();
+        floats += _buffers[i].uniforms.size();
+    }
+    out.packets.reserve(packets);
+    out.uniforms.reserve(floats);
+    for (size_t i = 0; i < chunks; i++)
+        out.append(_buffers[i]);
+}
@@ -0,0 +1,54 @@
+#ifndef _CGE_COMMAND_BUFFER_H_
+#define _CGE_COMMAND_BUFFER_H_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "render/RenderQueue.h"
+#include "utils/ThreadPool.h"
+
+namespace CGE
+{
+
+// Engine-level draw recording with no GL calls, safe to fill on any thread.
+struct CommandBuffer
+{
+    std::vector<DrawPacket> packets;
+    std::vector<float> uniforms;
+
+    void clear() { packets.clear(); uniforms.clear(); }
+    uint32_t pushMatrix(const float* m)
+    {
+        uint32_t offset = (uint32_t)uniforms.size();
+        uniforms.insert(uniforms.end(), m, m + 16);
+        return offset;
+    }
+    void submit(const DrawPacket& packet) { packets.push_back(packet); }
+    // model offsets of the appended packets are rebased
+    void append(const CommandBuffer& other);
+};
+
+// Records a range of scene items on the thread pool: each chunk culls, builds
+// keys and packs uniforms into its own command buffer, then the buffers are
+// merged in chunk order, so the result does not depend on which worker ran
+// which chunk.
+class ParallelRecorder
+{
+public:
+    typedef std::function<void(CommandBuffer&, size_t, size_t)> RecordFn;
+
+    ParallelRecorder(): _chunk(1024) {}
+
+    // record() divides by it, 0 means 1
+    void setChunkSize(size_t chunk) { _chunk = std::max<size_t>(chunk, 1); }
+    void record(CGE_UTIL::ThreadPool& pool, size_t count, const RecordFn& fn, CommandBuffer& out);
+
+private:
+    size_t _chunk;
+    std::vector<CommandBuffer> _buffers;    // one per chunk, capacity kept across frames
+};
+
+}
+
+#endif
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGE_CULL_SSE
+#endif
+
+#include "render/Culling.h"
+
+using namespace CGE;
+
+static const size_t kPad = 8;
+static const size_t kChunk = 4096;    // objects per parallel job, multiple of kPad
+
+static inline int lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// append base + i for every set bit i
+static inline void appendMask(unsigned mask, size_t base, std::vector<uint32_t>& out)
+{
+    while (mask)
+    {
+        out.push_back((uint32_t)(base + lowestBit(mask)));
+        mask &= mask - 1;
+    }
+}
+
+Frustum Frustum::fromMatrix(const float* m)
+{
+    // row i of the column major matrix is m[i], m[4 + i], m[8 + i], m[12 + i]
+    Frustum f;
+    for (int p = 0; p < 6; p++)
+    {
+        int row = p / 2;
+        float sign = (p % 2) ? -1.0f : 1.0f;
+        for (int c = 0; c < 4; c++)
+            f.planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+        float len = std::sqrt(f.planes[p][0] * f.planes[p][0] + f.planes[p][1] * f.planes[p][1] + f.planes[p][2] * f.planes[p][2]);
+        if (len > 0)
+            for (int c = 0; c < 4; c++) f.planes[p][c] /= len;
+    }
+    return f;
+}
+
+Frustum Frustum::fromView(const float* view, const float* projection)
+{
+    float m[16];
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) sum += projection[k * 4 + r] * view[c * 4 + k];
+            m[c * 4 + r] = sum;
+        }
+    return fromMatrix(m);
+}
+
+CullingSet::CullingSet(): _count(0), _simd(true)
+{
+}
+
+void CullingSet::clear()
+{
+    _count = 0;
+    for (std::vector<float>* a : { &_cx, &_cy, &_cz, &_ex, &_ey, &_ez, &_radius }) a->clear();
+}
+
+void CullingSet::reserve(size_t count)
+{
+    count = (count + kPad - 1) / kPad * kPad;
+    for (std::vector<float>* a : { &_cx, &_cy, &_cz, &_ex, &_ey, &_ez, &_radius }) a->reserve(count);
+}
+
+uint32_t CullingSet::add(const float center[3], const float extents[3])
+{
+    if (_count == _cx.size())
+    {
+        // padding objects sit at the origin with zero size, results are masked to _count
+        for (std::vector<float>* a : { &_cx, &_cy, &_cz, &_ex, &_ey, &_ez, &_radius })
+            a->resize(_count + kPad, 0.0f);
+    }
+    uint32_t index = (uint32_t)_count++;
+    set(index, center, extents);
+    return index;
+}
+
+void CullingSet::set(uint32_t index, const float center[3], const float extents[3])
+{
+    _cx[index] = center[0];
+    _cy[index] = center[1];
+    _cz[index] = center[2];
+    _ex[index] = extents[0];
+    _ey[index] = extents[1];
+    _ez[index] = extents[2];
+    _radius[index] = std::sqrt(extents[0] * extents[0] + extents[1] * extents[1] + extents[2] * extents[2]);
+}
+
+void CullingSet::setSphere(uint32_t index, const float center[3], float radius)
+{
+    // the box around the sphere keeps CULL_AABB conservative
+    const float extents[3] = { radius, radius, radius };
+    set(index, center, extents);
+    _radius[index] = radius;
+}
+
+const char* CullingSet::simdName()
+{
+#if defined(__AVX__)
+    return "avx";
+#elif defined(CGE_CULL_SSE)
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
+
+void CullingSet::cullScalar(const Frustum& frustum, size_t begin, size_t end, CullMode mode, std::vector<uint32_t>& out) const
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const float* n = frustum.planes[p];
+            float d = n[0] * _cx[i] + n[1] * _cy[i] + n[2] * _cz[i] + n[3];
+            float r = mode == CULL_SPHERE ? _radius[i] :
+                std::fabs(n[0]) * _ex[i] + std::fabs(n[1]) * _ey[i] + std::fabs(n[2]) * _ez[i];
+            inside = d + r >= 0;
+        }
+        if (inside) out.push_back((uint32_t)i);
+    }
+}
+
+void CullingSet::cullRange(const Frustum& frustum, size_t begin, size_t end, CullMode mode, std::vector<uint32_t>& out) const
+{
+    if (!_simd)
+    {
+        cullScalar(frustum, begin, end, mode, out);
+        return;
+    }
+    // begin is a multiple of kPad and the arrays are padded, whole vectors can always be loaded
+#if defined(__AVX__)
+    __m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    for (int p = 0; p < 6; p++)
+    {
+        nx[p] = _mm256_set1_ps(frustum.planes[p][0]);
+        ny[p] = _mm256_set1_ps(frustum.planes[p][1]);
+        nz[p] = _mm256_set1_ps(frustum.planes[p][2]);
+        nw[p] = _mm256_set1_ps(frustum.planes[p][3]);
+        ax[p] = _mm256_andnot_ps(sign, nx[p]);
+        ay[p] = _mm256_andnot_ps(sign, ny[p]);
+        az[p] = _mm256_andnot_ps(sign, nz[p]);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = begin; i < end; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&_cx[i]), cy = _mm256_loadu_ps(&_cy[i]), cz = _mm256_loadu_ps(&_cz[i]);
+        __m256 ex = _mm256_loadu_ps(&_ex[i]), ey = _mm256_loadu_ps(&_ey[i]), ez = _mm256_loadu_ps(&_ez[i]);
+        __m256 radius = _mm256_loadu_ps(&_radius[i]);
+        __m256 outside = zero;
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx), _mm256_mul_ps(ny[p], cy)),
+                _mm256_add_ps(_mm256_mul_ps(nz[p], cz), nw[p]));
+            __m256 r = mode == CULL_SPHERE ? radius :
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex), _mm256_mul_ps(ay[p], ey)), _mm256_mul_ps(az[p], ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_LT_OQ));
+        }
+        unsigned mask = ~(unsigned)_mm256_movemask_ps(outside) & 0xffu;
+        if (i + 8 > end) mask &= (1u << (end - i)) - 1;
+        appendMask(mask, i, out);
+    }
+#elif defined(CGE_CULL_SSE)
+    __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (int p = 0; p < 6; p++)
+    {
+        nx[p] = _mm_set1_ps(frustum.planes[p][0]);
+        ny[p] = _mm_set1_ps(frustum.planes[p][1]);
+        nz[p] = _mm_set1_ps(frustum.planes[p][2]);
+        nw[p] = _mm_set1_ps(frustum.planes[p][3]);
+        ax[p] = _mm_andnot_ps(sign, nx[p]);
+        ay[p] = _mm_andnot_ps(sign, ny[p]);
+        az[p] = _mm_andnot_ps(sign, nz[p]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = begin; i < end; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&_cx[i]), cy = _mm_loadu_ps(&_cy[i]), cz = _mm_loadu_ps(&_cz[i]);
+        __m128 ex = _mm_loadu_ps(&_ex[i]), ey = _mm_loadu_ps(&_ey[i]), ez = _mm_loadu_ps(&_ez[i]);
+        __m128 radius = _mm_loadu_ps(&_radius[i]);
+        __m128 outside = zero;
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+                _mm_add_ps(_mm_mul_ps(nz[p], cz), nw[p]));
+            __m128 r = mode == CULL_SPHERE ? radius :
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+        unsigned mask = ~(unsigned)_mm_movemask_ps(outside) & 0xfu;
+        if (i + 4 > end) mask &= (1u << (end - i)) - 1;
+        appendMask(mask, i, out);
+    }
+#else
+    cullScalar(frustum, begin, end, mode, out);
+#endif
+}
+
+size_t CullingSet::cull(const Frustum& frustum, std::vector<uint32_t>& visible, CGE_UTIL::ThreadPool* pool, CullMode mode)
+{
+    visible.clear();
+    if (!pool || pool->size() == 1 || _count <= kChunk)
+    {
+        visible.reserve(_count);
+        cullRange(frustum, 0, _count, mode, visible);
+        return visible.size();
+    }
+
+    size_t chunks = (_count + kChunk - 1) / kChunk;
+    if (_chunks.size() < chunks) _chunks.resize(chunks);
+    pool->parallelFor(chunks, 1, [&](size_t first, size_t last)
+    {
+        for (size_t c = first; c < last; c++)
+        {
+            _chunks[c].clear();
+            cullRange(frustum, c * kChunk, std::min(_count, (c + 1) * kChunk), mode, _chunks[c]);
+        }
+    });
+    // chunk order keeps the indices sorted
+    size_t total = 0;
+    for (size_t c = 0; c < chunks; c++) total += _chunks[c].size();
+    visible.reserve(total);
+    for (size_t c = 0; c < chunks; c++)
+        visible.insert(visible.end(), _chunks[c].begin(), _chunks[c].end());
+    return visible.size();
+}
+
+int CGE::benchmarkCulling(size_t count, unsigned threads)
+{
+    CullingSet set;
+    set.reserve(count);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float center[3] = { position(rng), position(rng), position(rng) };
+        const float extents[3] = { size(rng), size(rng), size(rng) };
+        set.add(center, extents);
+    }
+
+    // 60 degree perspective at the origin looking down -z, near 0.1, far 1000
+    float projection[16] = { 0 };
+    const float f = 1.0f / std::tan(30.0f * 3.14159265f / 180.0f), n = 0.1f, fr = 1000.0f;
+    projection[0] = f / (16.0f / 9.0f);
+    projection[5] = f;
+    projection[10] = (fr + n) / (n - fr);
+    projection[11] = -1;
+    projection[14] = 2 * fr * n / (n - fr);
+    const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    Frustum frustum = Frustum::fromView(identity, projection);
+
+    CGE_UTIL::ThreadPool pool(threads ? (int)threads - 1 : -1);
+    std::vector<uint32_t> visible;
+    struct Run { const char* name; bool simd; CullMode mode; CGE_UTIL::ThreadPool* pool; };
+    const Run runs[] = {
+        { "scalar aabb", false, CULL_AABB, nullptr },
+        { "simd sphere", true, CULL_SPHERE, nullptr },
+        { "simd aabb", true, CULL_AABB, nullptr },
+        { "simd aabb jobs", true, CULL_AABB, &pool },
+    };
+    std::cout << "culling " << count << " objects, " << CullingSet::simdName() << ", "
+        << pool.size() << " threads" << std::endl;
+    for (const Run& run : runs)
+    {
+        set.setSimd(run.simd);
+        set.cull(frustum, visible, run.pool, run.mode);     // warm up
+        int iterations = 0;
+        auto start = std::chrono::steady_clock::now();
+        double ms = 0;
+        while (ms < 250.0 || iterations < 3)
+        {
+            set.cull(frustum, visible, run.pool, run.mode);
+            iterations++;
+            ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        double per_cull = ms / iterations;
+        printf("  %-16s %8.3f ms  %10.0f objects/ms  %zu visible\n", run.name, per_cull, count / per_cull, visible.size());
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef _CGE_CULLING_H_
+#define _CGE_CULLING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/ThreadPool.h"
+
+namespace CGE
+{
+
+// Six planes, normals pointing inwards, ax + by + cz + d >= 0 inside.
+struct Frustum
+{
+    float planes[6][4];
+
+    // Gribb/Hartmann extraction from a column major projection * view matrix
+    static Frustum fromMatrix(const float* view_projection);
+    static Frustum fromView(const float* view, const float* projection);
+};
+
+enum CullMode
+{
+    CULL_SPHERE = 0,    // cheapest, conservative for long boxes
+    CULL_AABB,
+};
+
+// World space bounds of scene objects in structure-of-arrays form, so the
+// culling loop tests 4 (SSE) or 8 (AVX) objects per iteration. Indices are
+// stable, the arrays are padded to a multiple of 8 so the SIMD loop never
+// needs a scalar tail.
+class CullingSet
+{
+public:
+    CullingSet();
+
+    void clear();
+    void reserve(size_t count);
+    // returns the object index; the bounding sphere encloses the box
+    uint32_t add(const float center[3], const float extents[3]);
+    void set(uint32_t index, const float center[3], const float extents[3]);
+    void setSphere(uint32_t index, const float center[3], float radius);
+    size_t size() const { return _count; }
+    void bounds(uint32_t index, float center[3], float extents[3]) const
+    {
+        center[0] = _cx[index]; center[1] = _cy[index]; center[2] = _cz[index];
+        extents[0] = _ex[index]; extents[1] = _ey[index]; extents[2] = _ez[index];
+    }
+
+    // indices of the objects intersecting the frustum, in increasing order. With
+    // a pool, large sets are split into chunks culled in parallel. Not reentrant.
+    size_t cull(const Frustum& frustum, std::vector<uint32_t>& visible,
+        CGE_UTIL::ThreadPool* pool = nullptr, CullMode mode = CULL_AABB);
+
+    // the plain C++ loop instead of SSE/AVX, for comparison
+    void setSimd(bool simd) { _simd = simd; }
+    // "avx", "sse" or "scalar", decided at compile time
+    static const char* simdName();
+
+private:
+    void cullRange(const Frustum& frustum, size_t begin, size_t end, CullMode mode, std::vector<uint32_t>& out) const;
+    void cullScalar(const Frustum& frustum, size_t begin, size_t end, CullMode mode, std::vector<uint32_t>& out) const;
+
+    size_t _count;
+    std::vector<float> _cx, _cy, _cz;
+    std::vector<float> _ex, _ey, _ez;
+    std::vector<float> _radius;
+    std::vector<std::vector<uint32_t>> _chunks;    // per-chunk results, capacity kept across frames
+    bool _simd;
+};
+
+// --cull-bench: culls count random boxes, prints objects culled per millisecond
+int benchmarkCulling(size_t count, unsigned threads);
+
+}
+
+#endif
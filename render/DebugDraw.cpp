@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <iostream>
+
+#include "render/DebugDraw.h"
+#include "render/GLState.h"
+#include "render/RenderQueue.h"
+#include "render/StreamBuffer.h"
+
+using namespace CGE;
+
+static const char* kDebugVertexShader =
+    "#version 130\n"
+    "uniform mat4 view_projection;\n"
+    "in vec3 position;\n"
+    "in vec4 color;\n"
+    "out vec4 frag_color;\n"
+    "void main()\n"
+    "{\n"
+    "    frag_color = color;\n"
+    "    gl_Position = view_projection * vec4(position, 1.0);\n"
+    "}\n";
+
+static const char* kDebugFragmentShader =
+    "#version 130\n"
+    "in vec4 frag_color;\n"
+    "out vec4 out_color;\n"
+    "void main()\n"
+    "{\n"
+    "    out_color = frag_color;\n"
+    "}\n";
+
+DebugDraw::DebugDraw(): _time(0)
+{
+}
+
+uint32_t DebugDraw::packColor(const float color[4])
+{
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        float c = std::min(std::max(color[i], 0.0f), 1.0f);
+        packed |= (uint32_t)(c * 255.0f + 0.5f) << (8 * i);
+    }
+    return packed;
+}
+
+DebugDraw::Bucket& DebugDraw::bucket(GLenum mode, float width, bool depth_test, float duration)
+{
+    bool timed = duration > 0;
+    // depth tested first, then by mode and width, so equal styles end up adjacent
+    auto less = [](const Bucket& b, bool depth_test, GLenum mode, float width, bool timed)
+    {
+        if (b.depth_test != depth_test) return b.depth_test;
+        if (b.mode != mode) return b.mode < mode;
+        if (b.width != width) return b.width < width;
+        return !b.timed && timed;
+    };
+    size_t i = 0;
+    while (i < _buckets.size() && less(_buckets[i], depth_test, mode, width, timed)) i++;
+    if (i < _buckets.size())
+    {
+        Bucket& b = _buckets[i];
+        if (b.depth_test == depth_test && b.mode == mode && b.width == width && b.timed == timed)
+            return b;
+    }
+    Bucket b;
+    b.mode = mode;
+    b.width = width;
+    b.depth_test = depth_test;
+    b.timed = timed;
+    return *_buckets.insert(_buckets.begin() + i, b);
+}
+
+void DebugDraw::push(Bucket& bucket, const Eigen::Vector3d& p, uint32_t color)
+{
+    DebugVertex v;
+    v.pos[0] = (float)p.x();
+    v.pos[1] = (float)p.y();
+    v.pos[2] = (float)p.z();
+    v.color = color;
+    bucket.vertices.push_back(v);
+}
+
+void DebugDraw::line(const CGE_UTIL::Line& line, bool depth_test, float duration)
+{
+    lines(&line, 1, depth_test, duration);
+}
+
+void DebugDraw::lines(const CGE_UTIL::Line* lines, size_t count, bool depth_test, float duration)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Bucket* b = nullptr;
+    for (size_t i = 0; i < count; i++)
+    {
+        const CGE_UTIL::Line& l = lines[i];
+        if (!b || b->width != l.lineWidth) b = &bucket(GL_LINES, l.lineWidth, depth_test, duration);
+        uint32_t color = packColor(l.color);
+        push(*b, l.a, color);
+        push(*b, l.b, color);
+        if (b->timed) b->expiry.push_back(_time + duration);
+    }
+}
+
+void DebugDraw::line(const float a[3], const float b[3], const float color[4], float width,
+    bool depth_test, float duration)
+{
+    CGE_UTIL::Line l(Eigen::Vector3d(a[0], a[1], a[2]), Eigen::Vector3d(b[0], b[1], b[2]));
+    std::copy(color, color + 4, l.color);
+    l.lineWidth = width;
+    lines(&l, 1, depth_test, duration);
+}
+
+void DebugDraw::triangle(const CGE_UTIL::triangle& triangle, bool depth_test, float duration)
+{
+    triangles(&triangle, 1, depth_test, duration);
+}
+
+void DebugDraw::triangles(const CGE_UTIL::triangle* triangles, size_t count, bool depth_test, float duration)
+{
+    if (count == 0) return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    Bucket& b = bucket(GL_TRIANGLES, 1, depth_test, duration);
+    b.vertices.reserve(b.vertices.size() + count * 3);
+    for (size_t i = 0; i < count; i++)
+    {
+        const CGE_UTIL::triangle& t = triangles[i];
+        uint32_t color = packColor(t.color);
+        push(b, t.a, color);
+        push(b, t.b, color);
+        push(b, t.c, color);
+        if (b.timed) b.expiry.push_back(_time + duration);
+    }
+}
+
+void DebugDraw::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (Bucket& b : _buckets)
+    {
+        b.vertices.clear();
+        b.expiry.clear();
+    }
+}
+
+void DebugDraw::capture(DebugDrawList& out, double elapsed)
+{
+    out.clear();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _time += elapsed;
+    for (Bucket& b : _buckets)
+    {
+        if (b.timed)
+        {
+            // compact away what expired, order is kept
+            size_t stride = b.mode == GL_LINES ? 2 : 3;
+            size_t kept = 0;
+            for (size_t i = 0; i < b.expiry.size(); i++)
+            {
+                if (b.expiry[i] <= _time) continue;
+                if (kept != i)
+                {
+                    b.expiry[kept] = b.expiry[i];
+                    std::copy(b.vertices.begin() + i * stride, b.vertices.begin() + (i + 1) * stride,
+                        b.vertices.begin() + kept * stride);
+                }
+                kept++;
+            }
+            b.expiry.resize(kept);
+            b.vertices.resize(kept * stride);
+        }
+        if (b.vertices.empty()) continue;
+
+        // timed and one-frame buckets of the same style share a draw
+        DebugBatch* last = out.batches.empty() ? nullptr : &out.batches.back();
+        if (last && last->mode == b.mode && last->width == b.width && last->depth_test == b.depth_test)
+            last->count += (uint32_t)b.vertices.size();
+        else
+        {
+            DebugBatch batch;
+            batch.mode = b.mode;
+            batch.width = b.width;
+            batch.depth_test = b.depth_test;
+            batch.first = (uint32_t)out.vertices.size();
+            batch.count = (uint32_t)b.vertices.size();
+            out.batches.push_back(batch);
+        }
+        out.vertices.insert(out.vertices.end(), b.vertices.begin(), b.vertices.end());
+        if (!b.timed) b.vertices.clear();
+    }
+}
+
+static GLuint compileShader(GLenum type, const char* source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok)
+    {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cout << "Debug draw shader: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+DebugDrawRenderer::DebugDrawRenderer():
+    _program(0),
+    _vao(0),
+    _view_projection(-1)
+{
+    _stats.vertices = 0;
+    _stats.draws = 0;
+}
+
+bool DebugDrawRenderer::init()
+{
+    GLuint vs = compileShader(GL_VERTEX_SHADER, kDebugVertexShader);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, kDebugFragmentShader);
+    if (vs && fs)
+    {
+        _program = glCreateProgram();
+        glAttachShader(_program, vs);
+        glAttachShader(_program, fs);
+        glBindAttribLocation(_program, 0, "position");
+        glBindAttribLocation(_program, 1, "color");
+        glBindFragDataLocation(_program, 0, "out_color");
+        glLinkProgram(_program);
+        GLint ok = 0;
+        glGetProgramiv(_program, GL_LINK_STATUS, &ok);
+        if (!ok)
+        {
+            char log[1024];
+            glGetProgramInfoLog(_program, sizeof(log), nullptr, log);
+            std::cout << "Debug draw program: " << log << std::endl;
+            glDeleteProgram(_program);
+            _program = 0;
+        }
+    }
+    if (vs) glDeleteShader(vs);
+    if (fs) glDeleteShader(fs);
+    if (!_program) return false;
+
+    _view_projection = glGetUniformLocation(_program, "view_projection");
+    glGenVertexArrays(1, &_vao);
+    return true;
+}
+
+void DebugDrawRenderer::destroy()
+{
+    if (_vao) glDeleteVertexArrays(1, &_vao);
+    if (_program) glDeleteProgram(_program);
+    _vao = _program = 0;
+}
+
+void DebugDrawRenderer::draw(const DebugDrawList& list, const RenderView& view, StreamBuffer& stream, GLStateCache& state)
+{
+    _stats.vertices = list.vertices.size();
+    _stats.draws = 0;
+    if (!_program || list.vertices.empty()) return;
+
+    // one upload for the whole frame, an overflow grows the stream for the next one
+    GLintptr offset = stream.upload(list.vertices.data(), list.vertices.size() * sizeof(DebugVertex), sizeof(DebugVertex));
+    if (offset < 0) return;
+
+    // column major projection * view
+    float view_projection[16];
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) sum += view.projection[k * 4 + r] * view.view[c * 4 + k];
+            view_projection[c * 4 + r] = sum;
+        }
+
+    state.useProgram(_program);
+    glUniformMatrix4fv(_view_projection, 1, GL_FALSE, view_projection);
+    state.bindVertexArray(_vao);
+    // respecified every frame, the stream buffer is recreated when it grows
+    state.bindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void*)offset);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void*)(offset + 12));
+
+    state.setBlend(true);
+    state.setCull(false);
+    float width = 1;
+    for (const DebugBatch& batch : list.batches)
+    {
+        state.setDepth(batch.depth_test, false);
+        if (batch.mode == GL_LINES && batch.width != width)
+        {
+            width = batch.width;
+            glLineWidth(width);
+        }
+        glDrawArrays(batch.mode, batch.first, batch.count);
+        _stats.draws++;
+    }
+    if (width != 1) glLineWidth(1);
+    state.setDepth(true, true);
+    state.setBlend(false);
+}
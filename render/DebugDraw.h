@@ -0,0 +1,114 @@
+#ifndef _CGE_DEBUG_DRAW_H_
+#define _CGE_DEBUG_DRAW_H_
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "utils/geometry.h"
+
+namespace CGE
+{
+
+class GLStateCache;
+class StreamBuffer;
+struct RenderView;
+
+struct DebugVertex
+{
+    float pos[3];
+    uint32_t color;         // RGBA8
+};
+
+// run of vertices drawn with one call
+struct DebugBatch
+{
+    GLenum mode;            // GL_LINES or GL_TRIANGLES
+    float width;
+    bool depth_test;
+    uint32_t first, count;
+};
+
+// A frame's debug geometry, already grouped into batches.
+struct DebugDrawList
+{
+    std::vector<DebugVertex> vertices;
+    std::vector<DebugBatch> batches;
+
+    void clear() { vertices.clear(); batches.clear(); }
+};
+
+struct DebugDrawStats
+{
+    size_t vertices;
+    int draws;
+};
+
+// Immediate mode debug drawing for physics, AI and tools. Primitives go into
+// buckets by mode, width, depth test and lifetime, so a frame costs one draw
+// call per distinct style no matter how many primitives were added. Safe to
+// call from any thread, the bulk calls take the lock once.
+class DebugDraw
+{
+public:
+    DebugDraw();
+
+    // duration 0 draws in the next frame only, otherwise for that many seconds
+    void line(const CGE_UTIL::Line& line, bool depth_test = true, float duration = 0);
+    void lines(const CGE_UTIL::Line* lines, size_t count, bool depth_test = true, float duration = 0);
+    void line(const float a[3], const float b[3], const float color[4], float width = 1,
+        bool depth_test = true, float duration = 0);
+    void triangle(const CGE_UTIL::triangle& triangle, bool depth_test = true, float duration = 0);
+    void triangles(const CGE_UTIL::triangle* triangles, size_t count, bool depth_test = true, float duration = 0);
+
+    // drops timed primitives too
+    void clear();
+
+    // game thread, once per frame: ages timed primitives and batches everything into out
+    void capture(DebugDrawList& out, double elapsed);
+
+    static uint32_t packColor(const float color[4]);
+
+private:
+    struct Bucket
+    {
+        GLenum mode;
+        float width;
+        bool depth_test;
+        bool timed;
+        std::vector<DebugVertex> vertices;
+        std::vector<double> expiry;     // per primitive, timed buckets only
+    };
+    // under the lock
+    Bucket& bucket(GLenum mode, float width, bool depth_test, float duration);
+    void push(Bucket& bucket, const Eigen::Vector3d& p, uint32_t color);
+
+    std::mutex _mutex;
+    std::vector<Bucket> _buckets;   // sorted by style, timed after untimed
+    double _time;
+};
+
+// Draws DebugDrawLists out of the stream buffer, context thread only.
+class DebugDrawRenderer
+{
+public:
+    DebugDrawRenderer();
+
+    bool init();
+    void destroy();
+    void draw(const DebugDrawList& list, const RenderView& view, StreamBuffer& stream, GLStateCache& state);
+
+    const DebugDrawStats& stats() const { return _stats; }
+
+private:
+    GLuint _program;
+    GLuint _vao;
+    GLint _view_projection;
+    DebugDrawStats _stats;
+};
+
+}
+
+#endif
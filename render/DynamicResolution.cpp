@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cmath>
+
+#include "render/DynamicResolution.h"
+
+using namespace CGE;
+
+DynamicResolution::DynamicResolution(const DynamicResolutionOptions& options):
+    _options(options),
+    _enabled(true)
+{
+    reset();
+}
+
+void DynamicResolution::reset()
+{
+    _scale = _options.max_scale;
+    _smoothed_ms = 0.0;
+    _last_frame = 0;
+    _has_sample = false;
+    _cooldown = 0;
+}
+
+float DynamicResolution::quantize(float scale) const
+{
+    // round down, a shrink must not end up above the scale it asked for
+    float q = _options.step > 0 ? std::floor(scale / _options.step + 1e-4f) * _options.step : scale;
+    return std::min(_options.max_scale, std::max(_options.min_scale, q));
+}
+
+int DynamicResolution::scaled(int size) const
+{
+    return std::max(1, (int)std::lround(size * scale()));
+}
+
+void DynamicResolution::update(uint64_t frame, double gpu_ms)
+{
+    if (_has_sample && frame <= _last_frame) return;
+    // a single spike (shader compile, upload) should not halve the resolution
+    _smoothed_ms = _has_sample ? _smoothed_ms * 0.75 + gpu_ms * 0.25 : gpu_ms;
+    _has_sample = true;
+    _last_frame = frame;
+    if (!_enabled || gpu_ms <= 0.0) return;
+    if (_cooldown > 0)
+    {
+        _cooldown--;
+        return;
+    }
+
+    float next = _scale;
+    if (_smoothed_ms > _options.target_ms)
+    {
+        // GPU time roughly follows the pixel count, the scale squared
+        next = quantize(_scale * (float)std::sqrt(_options.target_ms / _smoothed_ms));
+        if (next == _scale) next = quantize(_scale - _options.step);
+    }
+    else if (_smoothed_ms < _options.target_ms * (1.0 - _options.headroom))
+        next = quantize(_scale + _options.step);
+
+    if (next != _scale)
+    {
+        _scale = next;
+        _cooldown = _options.settle_frames;
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef _CGE_DYNAMIC_RESOLUTION_H_
+#define _CGE_DYNAMIC_RESOLUTION_H_
+
+#include <cstdint>
+
+namespace CGE
+{
+
+struct DynamicResolutionOptions
+{
+    double target_ms;       // GPU frame time to hold
+    float min_scale, max_scale;
+    float step;             // scales are multiples of this, so targets only resize in steps
+    double headroom;        // grow only below (1 - headroom) * target_ms
+    int settle_frames;      // frames to wait after a change, covers the query latency
+
+    DynamicResolutionOptions(): target_ms(1000.0 / 60.0 * 0.9), min_scale(0.5f), max_scale(1.0f),
+        step(0.05f), headroom(0.2), settle_frames(8) {}
+};
+
+// Scales the 3D render target from GPU frame times. Over budget it shrinks at
+// once, by the ratio the pixel count has to drop; under budget by more than
+// the headroom it grows one step at a time. Between the two it holds, and each
+// change waits settle_frames so the next sample already reflects it.
+class DynamicResolution
+{
+public:
+    explicit DynamicResolution(const DynamicResolutionOptions& options = DynamicResolutionOptions());
+
+    // one sample per resolved GPU frame, repeated frame indices are ignored
+    void update(uint64_t frame, double gpu_ms);
+    void reset();
+
+    float scale() const { return _enabled ? _scale : 1.0f; }
+    double smoothedMs() const { return _smoothed_ms; }
+    bool enabled() const { return _enabled; }
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    DynamicResolutionOptions& options() { return _options; }
+
+    // pixels at the current scale, at least 1
+    int scaled(int size) const;
+
+private:
+    float quantize(float scale) const;
+
+    DynamicResolutionOptions _options;
+    bool _enabled;
+    float _scale;
+    double _smoothed_ms;
+    uint64_t _last_frame;
+    bool _has_sample;
+    int _cooldown;
+};
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "render/FrameCapture.h"
+#include "render/GLExt.h"
+#include "render/GLState.h"
+
+using namespace CGE;
+
+FrameCapture::FrameCapture():
+    _state(nullptr),
+    _persistent(false),
+    _sync(false),
+    _screenshot_format(CAPTURE_PNG),
+    _sequence_format(CAPTURE_PNG),
+    _sequence_left(0),
+    _stop(false)
+{
+    for (Slot& slot : _slots)
+    {
+        slot.buffer = 0;
+        slot.size = 0;
+        slot.persistent = nullptr;
+        slot.fence = 0;
+        slot.state = SLOT_FREE;
+        slot.width = slot.height = 0;
+        slot.issued = 0;
+        slot.format = CAPTURE_PNG;
+    }
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+FrameCapture::~FrameCapture()
+{
+    // GL objects are released in destroy(), the context may be gone by now
+    if (_writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cond.notify_all();
+        _writer.join();
+    }
+}
+
+void FrameCapture::init(GLStateCache* state)
+{
+    _state = state;
+    const GLExtensions& ext = glExtensions();
+    _sync = ext.sync;
+    _persistent = ext.buffer_storage && ext.sync;
+    _stop = false;
+    _writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+void FrameCapture::bindPack(GLuint buffer)
+{
+    if (_state) _state->bindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    else glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+}
+
+void FrameCapture::allocate(Slot& slot, GLsizeiptr size)
+{
+    if (slot.buffer)
+    {
+        if (slot.persistent)
+        {
+            bindPack(slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+        if (_state) _state->forgetBuffer(slot.buffer);
+    }
+    slot.persistent = nullptr;
+    slot.size = size;
+    glGenBuffers(1, &slot.buffer);
+    bindPack(slot.buffer);
+    if (_persistent)
+    {
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExtensions().BufferStorage(GL_PIXEL_PACK_BUFFER, size, nullptr, flags | GL_CLIENT_STORAGE_BIT);
+        slot.persistent = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, flags);
+        if (slot.persistent) return;
+        std::cout << "Persistent readback mapping failed, copying captures out" << std::endl;
+        _persistent = false;
+        allocate(slot, size);
+        return;
+    }
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+}
+
+bool FrameCapture::ready(Slot& slot, uint64_t frame)
+{
+    if (!slot.fence) return frame >= slot.issued + kSlots;    // no fences, assume kSlots frames of latency
+    GLenum result = glClientWaitSync(slot.fence, 0, 0);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) return false;
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+    return true;
+}
+
+void FrameCapture::destroy()
+{
+    // finish what was read, GL calls stay on this thread
+    for (Slot& slot : _slots)
+    {
+        if (slot.state != SLOT_READING) continue;
+        if (slot.fence)
+        {
+            while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+        }
+        slot.issued = 0;
+    }
+    // no fences left, so the update below hands every read slot to the writer
+    update(0, 0, 0, kSlots);
+    if (_writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cond.notify_all();
+        _writer.join();
+    }
+    for (Slot& slot : _slots)
+    {
+        if (!slot.buffer) continue;
+        if (slot.persistent)
+        {
+            bindPack(slot.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+        if (_state) _state->forgetBuffer(slot.buffer);
+        slot.buffer = 0;
+        slot.persistent = nullptr;
+        slot.state = SLOT_FREE;
+    }
+    bindPack(0);
+}
+
+void FrameCapture::screenshot(const std::string& prefix, CaptureFormat format)
+{
+    std::lock_guard<std::mutex> lock(_request_mutex);
+    _screenshot_prefix = prefix;
+    _screenshot_format = format;
+}
+
+void FrameCapture::startSequence(const std::string& prefix, int frames, CaptureFormat format)
+{
+    std::lock_guard<std::mutex> lock(_request_mutex);
+    _sequence_prefix = prefix;
+    _sequence_format = format;
+    _sequence_left = frames > 0 ? frames : -1;
+}
+
+void FrameCapture::stopSequence()
+{
+    std::lock_guard<std::mutex> lock(_request_mutex);
+    _sequence_left = 0;
+}
+
+bool FrameCapture::sequenceActive() const
+{
+    std::lock_guard<std::mutex> lock(_request_mutex);
+    return _sequence_left != 0;
+}
+
+void FrameCapture::update(GLuint framebuffer, int width, int height, uint64_t frame)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // hand finished readbacks to the writer, it only touches slots in SLOT_WRITING
+    int reading[kSlots], count = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int i = 0; i < kSlots; i++)
+            if (_slots[i].state == SLOT_READING) reading[count++] = i;
+    }
+    bool queued = false;
+    for (int r = 0; r < count; r++)
+    {
+        int i = reading[r];
+        Slot& slot = _slots[i];
+        if (!ready(slot, frame)) continue;
+        if (!slot.persistent)
+        {
+            bindPack(slot.buffer);
+            GLsizeiptr bytes = (GLsizeiptr)slot.width * slot.height * 4;
+            const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+            if (data) slot.copy.assign((const uint8_t*)data, (const uint8_t*)data + bytes);
+            else slot.copy.clear();
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        slot.state = SLOT_WRITING;
+        _queue.push_back(i);
+        queued = true;
+    }
+    if (queued) _cond.notify_one();
+
+    // a capture due this frame?
+    std::string prefix;
+    CaptureFormat format = CAPTURE_PNG;
+    if (width > 0 && height > 0)
+    {
+        std::lock_guard<std::mutex> lock(_request_mutex);
+        if (!_screenshot_prefix.empty())
+        {
+            prefix.swap(_screenshot_prefix);
+            format = _screenshot_format;
+        }
+        else if (_sequence_left != 0)
+        {
+            prefix = _sequence_prefix;
+            format = _sequence_format;
+            if (_sequence_left > 0) _sequence_left--;
+        }
+    }
+
+    if (!prefix.empty())
+    {
+        Slot* slot = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (Slot& s : _slots)
+                if (s.state == SLOT_FREE)
+                {
+                    slot = &s;
+                    break;
+                }
+            if (!slot) _stats.dropped++;
+        }
+        if (slot)
+        {
+            GLsizeiptr bytes = (GLsizeiptr)width * height * 4;
+            if (!slot->buffer || slot->size < bytes) allocate(*slot, bytes);
+            char name[64];
+            snprintf(name, sizeof(name), format == CAPTURE_PNG ? "_%06llu.png" : "_%06llu_%dx%d.rgba",
+                (unsigned long long)frame, width, height);
+            slot->path = prefix + name;
+            slot->format = format;
+            slot->width = width;
+            slot->height = height;
+            slot->issued = frame;
+
+            if (_state) _state->bindFramebuffer(framebuffer);
+            else glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            bindPack(slot->buffer);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            bindPack(0);
+            if (_sync) slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            std::lock_guard<std::mutex> lock(_mutex);
+            slot->state = SLOT_READING;
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.cpu_ms = ms;
+}
+
+CaptureStats FrameCapture::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    CaptureStats stats = _stats;
+    stats.pending = 0;
+    for (const Slot& slot : _slots)
+        if (slot.state != SLOT_FREE) stats.pending++;
+    return stats;
+}
+
+void FrameCapture::writerLoop()
+{
+    for (;;)
+    {
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [&] { return _stop || !_queue.empty(); });
+            if (_queue.empty()) return;
+            index = _queue.front();
+            _queue.pop_front();
+        }
+        Slot& slot = _slots[index];
+        const uint8_t* pixels = slot.persistent ? slot.persistent : slot.copy.data();
+        bool ok = false;
+        if (pixels && (slot.persistent || !slot.copy.empty()))
+        {
+            // GL rows run bottom up
+            const int stride = slot.width * 4;
+            if (slot.format == CAPTURE_PNG)
+            {
+                // last row first with a negative stride, this stb predates flip on write
+                ok = stbi_write_png(slot.path.c_str(), slot.width, slot.height, 4,
+                    pixels + (size_t)(slot.height - 1) * stride, -stride) != 0;
+            }
+            else if (FILE* file = fopen(slot.path.c_str(), "wb"))
+            {
+                ok = true;
+                for (int y = slot.height - 1; y >= 0 && ok; y--)
+                    ok = fwrite(pixels + (size_t)y * stride, 1, stride, file) == (size_t)stride;
+                fclose(file);
+            }
+        }
+        if (!ok) std::cout << "Failed to write capture " << slot.path << std::endl;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        slot.state = SLOT_FREE;
+        if (ok) _stats.written++;
+    }
+}
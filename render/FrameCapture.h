@@ -0,0 +1,105 @@
+#ifndef _CGE_FRAME_CAPTURE_H_
+#define _CGE_FRAME_CAPTURE_H_
+
+#include <glad/gl.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CGE
+{
+
+class GLStateCache;
+
+enum CaptureFormat { CAPTURE_PNG, CAPTURE_RAW };   // raw: RGBA8 rows top down, size in the file name
+
+struct CaptureStats
+{
+    double cpu_ms;          // context thread time of the last update()
+    uint64_t written;
+    uint64_t dropped;       // frames skipped because every slot was busy
+    int pending;            // readbacks in flight or waiting for the writer
+};
+
+// Screenshots and frame sequences without stalling the pipeline. update() issues
+// glReadPixels into one of kSlots pixel pack buffers with a fence; a later
+// update() hands the slot to a writer thread once the fence has signalled.
+// With ARB_buffer_storage the slots stay persistently mapped and the writer
+// reads them in place, otherwise they are mapped and copied out. When all
+// slots are busy the frame is dropped instead of waited for.
+class FrameCapture
+{
+public:
+    static const int kSlots = 4;
+
+    FrameCapture();
+    ~FrameCapture();
+
+    // context thread; state, when given, is used for the buffer binds
+    void init(GLStateCache* state = nullptr);
+    // waits for the readbacks and files still pending
+    void destroy();
+
+    // any thread: capture the next frame to prefix_<frame>.png/.rgba
+    void screenshot(const std::string& prefix, CaptureFormat format = CAPTURE_PNG);
+    // every frame from the next one on, frames 0 until stopSequence()
+    void startSequence(const std::string& prefix, int frames = 0, CaptureFormat format = CAPTURE_PNG);
+    void stopSequence();
+    bool sequenceActive() const;
+
+    // context thread, once per frame after drawing: reads the framebuffer's
+    // bottom left width x height when a capture is due and collects finished readbacks
+    void update(GLuint framebuffer, int width, int height, uint64_t frame);
+
+    CaptureStats stats() const;
+
+private:
+    enum SlotState { SLOT_FREE, SLOT_READING, SLOT_WRITING };
+    struct Slot
+    {
+        GLuint buffer;
+        GLsizeiptr size;
+        const uint8_t* persistent;
+        GLsync fence;
+        SlotState state;
+        int width, height;
+        uint64_t issued;        // frame the read was issued, for the no-sync fallback
+        std::string path;
+        CaptureFormat format;
+        std::vector<uint8_t> copy;  // pixels copied out when not persistently mapped
+    };
+
+    void bindPack(GLuint buffer);
+    void allocate(Slot& slot, GLsizeiptr size);
+    bool ready(Slot& slot, uint64_t frame);
+    void writerLoop();
+
+    GLStateCache* _state;
+    bool _persistent;
+    bool _sync;
+    Slot _slots[kSlots];
+
+    // requests from any thread
+    mutable std::mutex _request_mutex;
+    std::string _screenshot_prefix;
+    CaptureFormat _screenshot_format;
+    std::string _sequence_prefix;
+    CaptureFormat _sequence_format;
+    int _sequence_left;         // -1 unbounded, 0 off
+
+    // writer thread, slot states and stats
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    std::deque<int> _queue;
+    bool _stop;
+    std::thread _writer;
+    CaptureStats _stats;
+};
+
+}
+
+#endif
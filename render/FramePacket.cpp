@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "render/FramePacket.h"
+
+using namespace CGE;
+
+DrawDataSnapshot::~DrawDataSnapshot()
+{
+    for (ImDrawList* list : _lists) IM_DELETE(list);
+}
+
+void DrawDataSnapshot::capture(const ImDrawData* src)
+{
+    _data.Clear();
+    if (!src || !src->Valid) return;
+
+    while ((int)_lists.size() < src->CmdListsCount)
+        _lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    for (int i = 0; i < src->CmdListsCount; i++)
+    {
+        const ImDrawList* from = src->CmdLists[i];
+        ImDrawList* to = _lists[i];
+        to->CmdBuffer = from->CmdBuffer;
+        to->IdxBuffer = from->IdxBuffer;
+        to->VtxBuffer = from->VtxBuffer;
+        to->Flags = from->Flags;
+    }
+
+    _data.Valid = true;
+    _data.CmdListsCount = src->CmdListsCount;
+    _data.TotalIdxCount = src->TotalIdxCount;
+    _data.TotalVtxCount = src->TotalVtxCount;
+    _data.CmdLists = _lists.data();
+    _data.DisplayPos = src->DisplayPos;
+    _data.DisplaySize = src->DisplaySize;
+    _data.FramebufferScale = src->FramebufferScale;
+    _data.OwnerViewport = src->OwnerViewport;
+}
+
+void DrawDataSnapshot::replaceTexture(ImTextureID from, ImTextureID to, float u_scale, float v_scale)
+{
+    for (int i = 0; i < _data.CmdListsCount; i++)
+    {
+        ImDrawList* list = _data.CmdLists[i];
+        for (ImDrawCmd& cmd : list->CmdBuffer)
+        {
+            if (cmd.UserCallback || cmd.TextureId != from) continue;
+            cmd.TextureId = to;
+            if (u_scale == 1.0f && v_scale == 1.0f) continue;
+            // images own their vertices, scale each one once
+            unsigned lo = 0xffffffffu, hi = 0;
+            for (unsigned e = 0; e < cmd.ElemCount; e++)
+            {
+                unsigned index = list->IdxBuffer[cmd.IdxOffset + e];
+                lo = std::min(lo, index);
+                hi = std::max(hi, index);
+            }
+            for (unsigned v = lo; v <= hi && cmd.ElemCount; v++)
+            {
+                ImDrawVert& vertex = list->VtxBuffer[cmd.VtxOffset + v];
+                vertex.uv.x *= u_scale;
+                vertex.uv.y *= v_scale;
+            }
+        }
+    }
+}
+
+FramePipeline::FramePipeline():
+    _write(0),
+    _stopped(false)
+{
+    _busy[0] = _busy[1] = false;
+}
+
+FramePacket& FramePipeline::acquireWrite()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [&] { return !_busy[_write]; });
+    return _packets[_write];
+}
+
+void FramePipeline::publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _busy[_write] = true;
+        _ready.push_back(_write);
+        _write ^= 1;
+    }
+    _cond.notify_all();
+}
+
+FramePacket* FramePipeline::acquireRead()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [&] { return !_ready.empty() || _stopped; });
+    if (_ready.empty()) return nullptr;
+    return &_packets[_ready.front()];
+}
+
+void FramePipeline::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _busy[_ready.front()] = false;
+        _ready.pop_front();
+    }
+    _cond.notify_all();
+}
+
+void FramePipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopped = true;
+    }
+    _cond.notify_all();
+}
+
+void FramePipeline::restart()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopped = false;
+}
@@ -0,0 +1,87 @@
+#ifndef _CGE_FRAME_PACKET_H_
+#define _CGE_FRAME_PACKET_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "imgui.h"
+#include "render/CommandBuffer.h"
+#include "render/DebugDraw.h"
+#include "render/RenderQueue.h"
+
+namespace CGE
+{
+
+// Deep copy of ImDrawData, stays valid while ImGui builds the next frame.
+// Draw lists are pooled so steady state copies only reuse capacity.
+class DrawDataSnapshot
+{
+public:
+    DrawDataSnapshot() {}
+    ~DrawDataSnapshot();
+
+    void capture(const ImDrawData* src);
+    ImDrawData* data() { return &_data; }
+    // points draws of a placeholder texture at a real one, scaling their uvs
+    // to the part of it that was rendered
+    void replaceTexture(ImTextureID from, ImTextureID to, float u_scale = 1.0f, float v_scale = 1.0f);
+
+private:
+    DrawDataSnapshot(const DrawDataSnapshot&);
+    DrawDataSnapshot& operator=(const DrawDataSnapshot&);
+
+    ImDrawData _data;
+    std::vector<ImDrawList*> _lists;
+};
+
+// Everything the render thread needs for one frame, immutable once published.
+struct FramePacket
+{
+    uint64_t index;
+    int display_w, display_h;
+    ImVec4 clear_color;
+    int scene_w, scene_h;   // framebuffer pixels of the Core window's scene image, 0 when hidden
+    bool dynamic_resolution;
+    RenderView view;
+    CommandBuffer scene;
+    DebugDrawList debug;
+    DrawDataSnapshot ui;
+
+    FramePacket(): index(0), display_w(0), display_h(0), scene_w(0), scene_h(0), dynamic_resolution(false) {}
+};
+
+// Two frame packets between the game and render threads: the game thread fills
+// one while the render thread consumes the other, so it runs at most one frame
+// ahead.
+class FramePipeline
+{
+public:
+    FramePipeline();
+
+    // game thread: waits until the render thread is done with the slot
+    FramePacket& acquireWrite();
+    void publish();
+
+    // render thread: waits for the next published packet, nullptr once stopped and drained
+    FramePacket* acquireRead();
+    void release();
+
+    void stop();
+    void restart();
+
+private:
+    FramePacket _packets[2];
+    bool _busy[2];
+    int _write;
+    std::deque<int> _ready;
+    bool _stopped;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+}
+
+#endif
@@ -0,0 +1,1042 @@
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "render/GLCapture.h"
+
+using namespace CGE;
+
+// Argument kinds of the plain calls:
+//   v value, B buffer, T texture, V vertex array, F framebuffer, R renderbuffer,
+//   S sampler, P program or shader, U uniform location in the current program,
+//   I uniform block index of the call's program argument
+#define CGE_GL_PLAIN_CALLS(X) \
+    X(ActiveTexture, "v") \
+    X(AttachShader, "PP") \
+    X(BindBuffer, "vB") \
+    X(BindBufferBase, "vvB") \
+    X(BindBufferRange, "vvBvv") \
+    X(BindFramebuffer, "vF") \
+    X(BindRenderbuffer, "vR") \
+    X(BindSampler, "vS") \
+    X(BindTexture, "vT") \
+    X(BindVertexArray, "V") \
+    X(BlendEquation, "v") \
+    X(BlendEquationSeparate, "vv") \
+    X(BlendFunc, "vv") \
+    X(BlendFuncSeparate, "vvvv") \
+    X(BlitFramebuffer, "vvvvvvvvvv") \
+    X(Clear, "v") \
+    X(ClearColor, "vvvv") \
+    X(ClearDepth, "v") \
+    X(ColorMask, "vvvv") \
+    X(CompileShader, "P") \
+    X(CullFace, "v") \
+    X(DeleteProgram, "P") \
+    X(DeleteShader, "P") \
+    X(DepthFunc, "v") \
+    X(DepthMask, "v") \
+    X(DetachShader, "PP") \
+    X(Disable, "v") \
+    X(DisableVertexAttribArray, "v") \
+    X(DrawArrays, "vvv") \
+    X(DrawArraysInstanced, "vvvv") \
+    X(DrawBuffer, "v") \
+    X(DrawElements, "vvvv") \
+    X(DrawElementsBaseVertex, "vvvvv") \
+    X(DrawElementsInstanced, "vvvvv") \
+    X(Enable, "v") \
+    X(EnableVertexAttribArray, "v") \
+    X(FramebufferRenderbuffer, "vvvR") \
+    X(FramebufferTexture2D, "vvvTv") \
+    X(GenerateMipmap, "v") \
+    X(LineWidth, "v") \
+    X(LinkProgram, "P") \
+    X(PixelStorei, "vv") \
+    X(PolygonMode, "vv") \
+    X(ReadBuffer, "v") \
+    X(RenderbufferStorage, "vvvv") \
+    X(Scissor, "vvvv") \
+    X(TexParameteri, "vvv") \
+    X(Uniform1f, "Uv") \
+    X(Uniform1i, "Uv") \
+    X(Uniform2f, "Uvv") \
+    X(Uniform3f, "Uvvv") \
+    X(Uniform4f, "Uvvvv") \
+    X(UniformBlockBinding, "PIv") \
+    X(UseProgram, "P") \
+    X(VertexAttribDivisor, "vv") \
+    X(VertexAttribIPointer, "vvvvv") \
+    X(VertexAttribPointer, "vvvvvv") \
+    X(Viewport, "vvvv")
+
+// glGen* / glDelete* pairs and the name kind they create
+#define CGE_GL_OBJECT_CALLS(X) \
+    X(Buffers, 'B') \
+    X(Textures, 'T') \
+    X(VertexArrays, 'V') \
+    X(Framebuffers, 'F') \
+    X(Renderbuffers, 'R') \
+    X(Samplers, 'S')
+
+// location, count, values, components per element
+#define CGE_GL_UNIFORM_VECTOR_CALLS(X) \
+    X(Uniform1fv, GLfloat, 1) \
+    X(Uniform2fv, GLfloat, 2) \
+    X(Uniform3fv, GLfloat, 3) \
+    X(Uniform4fv, GLfloat, 4) \
+    X(Uniform1iv, GLint, 1)
+
+// location, count, transpose, values
+#define CGE_GL_UNIFORM_MATRIX_CALLS(X) \
+    X(UniformMatrix3fv, 9) \
+    X(UniformMatrix4fv, 16)
+
+enum Opcode
+{
+    OP_FRAME = 0,
+#define X(name, kinds) OP_##name,
+    CGE_GL_PLAIN_CALLS(X)
+#undef X
+#define X(name, kind) OP_Gen##name, OP_Delete##name,
+    CGE_GL_OBJECT_CALLS(X)
+#undef X
+#define X(name, type, n) OP_##name,
+    CGE_GL_UNIFORM_VECTOR_CALLS(X)
+#undef X
+#define X(name, n) OP_##name,
+    CGE_GL_UNIFORM_MATRIX_CALLS(X)
+#undef X
+    OP_CreateShader,
+    OP_CreateProgram,
+    OP_ShaderSource,
+    OP_BindAttribLocation,
+    OP_BindFragDataLocation,
+    OP_GetUniformLocation,
+    OP_GetUniformBlockIndex,
+    OP_BufferData,
+    OP_BufferSubData,
+    OP_TexImage2D,
+    OP_TexSubImage2D,
+    OP_MappedWrite,     // contents of a glMapBufferRange write, taken at glUnmapBuffer
+    OP_FenceSync,
+    OP_ClientWaitSync,
+    OP_WaitSync,
+    OP_DeleteSync,
+};
+
+static const char kMagic[8] = { 'C', 'G', 'E', 'G', 'L', 'C', 'A', 'P' };
+static const uint32_t kVersion = 1;
+
+static const char* kNameKinds = "BTVFRSP";
+
+// ---------------------------------------------------------------------------
+// recording
+
+namespace
+{
+
+struct Mapping
+{
+    GLenum target;
+    GLintptr offset;
+    GLsizeiptr length;
+    GLbitfield access;
+    void* ptr;
+};
+
+struct RecordState
+{
+    FILE* file;
+    std::vector<uint8_t> buffer;
+    std::vector<std::function<void()>> restore;
+    std::vector<Mapping> mappings;
+    std::unordered_map<GLsync, uint32_t> syncs;
+    uint32_t next_sync;
+
+    RecordState(): file(nullptr), next_sync(1) {}
+};
+
+RecordState rec;
+
+void putVarint(uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        rec.buffer.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    rec.buffer.push_back((uint8_t)v);
+}
+
+void putRaw(const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    rec.buffer.insert(rec.buffer.end(), bytes, bytes + size);
+}
+
+void putBlob(const void* data, size_t size)
+{
+    putVarint(size);
+    if (size) putRaw(data, size);
+}
+
+void putString(const char* s)
+{
+    putBlob(s, s ? strlen(s) : 0);
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value>::type put(T v)
+{
+    if (std::is_signed<T>::value)
+    {
+        int64_t s = (int64_t)v;
+        putVarint(((uint64_t)s << 1) ^ (uint64_t)(s >> 63));
+    }
+    else
+        putVarint((uint64_t)v);
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type put(T v)
+{
+    putRaw(&v, sizeof(v));
+}
+
+// buffer offsets passed as pointers (vertex attributes, indices)
+template <typename T>
+void put(T* v)
+{
+    putVarint((uint64_t)(uintptr_t)v);
+}
+
+void begin(int op)
+{
+    putVarint((uint64_t)op);
+}
+
+template <typename F>
+void hook(F& ptr, F& real, F wrapper)
+{
+    if (!ptr) return;
+    real = ptr;
+    ptr = wrapper;
+    F* slot = &ptr;
+    F original = real;
+    rec.restore.push_back([slot, original] { *slot = original; });
+}
+
+template <int OP, typename... A>
+struct Plain
+{
+    static void (GLAD_API_PTR *real)(A...);
+    static void GLAD_API_PTR call(A... a)
+    {
+        begin(OP);
+        int unused[] = { 0, (put(a), 0)... };
+        (void)unused;
+        real(a...);
+    }
+};
+
+template <int OP, typename... A>
+void (GLAD_API_PTR *Plain<OP, A...>::real)(A...) = nullptr;
+
+template <int OP, typename... A>
+void hookPlain(void (GLAD_API_PTR *&ptr)(A...))
+{
+    hook(ptr, Plain<OP, A...>::real, &Plain<OP, A...>::call);
+}
+
+template <int GEN, int DEL>
+struct Objects
+{
+    static void (GLAD_API_PTR *gen)(GLsizei, GLuint*);
+    static void (GLAD_API_PTR *del)(GLsizei, const GLuint*);
+    static void GLAD_API_PTR genCall(GLsizei n, GLuint* names)
+    {
+        gen(n, names);
+        begin(GEN);
+        put(n);
+        for (GLsizei i = 0; i < n; i++) put(names[i]);
+    }
+    static void GLAD_API_PTR delCall(GLsizei n, const GLuint* names)
+    {
+        begin(DEL);
+        put(n);
+        for (GLsizei i = 0; i < n; i++) put(names[i]);
+        del(n, names);
+    }
+};
+
+template <int GEN, int DEL>
+void (GLAD_API_PTR *Objects<GEN, DEL>::gen)(GLsizei, GLuint*) = nullptr;
+template <int GEN, int DEL>
+void (GLAD_API_PTR *Objects<GEN, DEL>::del)(GLsizei, const GLuint*) = nullptr;
+
+// bytes of a client side image, honouring the unpack state the call sees
+size_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+    size_t components = 4;
+    switch (format)
+    {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+    case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL: components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+    default: break;
+    }
+    size_t pixel;
+    switch (type)
+    {
+    case GL_UNSIGNED_BYTE: case GL_BYTE: pixel = components; break;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: pixel = components * 2; break;
+    case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: pixel = 4; break;
+    default: pixel = components * 4; break;
+    }
+    GLint alignment = 4, row_length = 0;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &row_length);
+    size_t row = (size_t)(row_length > 0 ? row_length : width) * pixel;
+    row = (row + alignment - 1) / alignment * alignment;
+    return height > 0 ? row * (height - 1) + (size_t)width * pixel : 0;
+}
+
+bool unpackBufferBound()
+{
+    GLint buffer = 0;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &buffer);
+    return buffer != 0;
+}
+
+#define CGE_GL_REAL(name) decltype(glad_gl##name) real_##name = nullptr;
+CGE_GL_REAL(CreateShader)
+CGE_GL_REAL(CreateProgram)
+CGE_GL_REAL(ShaderSource)
+CGE_GL_REAL(BindAttribLocation)
+CGE_GL_REAL(BindFragDataLocation)
+CGE_GL_REAL(GetUniformLocation)
+CGE_GL_REAL(GetUniformBlockIndex)
+CGE_GL_REAL(BufferData)
+CGE_GL_REAL(BufferSubData)
+CGE_GL_REAL(TexImage2D)
+CGE_GL_REAL(TexSubImage2D)
+CGE_GL_REAL(MapBufferRange)
+CGE_GL_REAL(UnmapBuffer)
+CGE_GL_REAL(FenceSync)
+CGE_GL_REAL(ClientWaitSync)
+CGE_GL_REAL(WaitSync)
+CGE_GL_REAL(DeleteSync)
+#define X(name, type, n) CGE_GL_REAL(name)
+CGE_GL_UNIFORM_VECTOR_CALLS(X)
+#undef X
+#define X(name, n) CGE_GL_REAL(name)
+CGE_GL_UNIFORM_MATRIX_CALLS(X)
+#undef X
+#undef CGE_GL_REAL
+
+GLuint GLAD_API_PTR recCreateShader(GLenum type)
+{
+    GLuint shader = real_CreateShader(type);
+    begin(OP_CreateShader);
+    put(type);
+    put(shader);
+    return shader;
+}
+
+GLuint GLAD_API_PTR recCreateProgram()
+{
+    GLuint program = real_CreateProgram();
+    begin(OP_CreateProgram);
+    put(program);
+    return program;
+}
+
+void GLAD_API_PTR recShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+{
+    begin(OP_ShaderSource);
+    put(shader);
+    put(count);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (lengths && lengths[i] >= 0) putBlob(strings[i], lengths[i]);
+        else putString(strings[i]);
+    }
+    real_ShaderSource(shader, count, strings, lengths);
+}
+
+void GLAD_API_PTR recBindAttribLocation(GLuint program, GLuint index, const GLchar* name)
+{
+    begin(OP_BindAttribLocation);
+    put(program);
+    put(index);
+    putString(name);
+    real_BindAttribLocation(program, index, name);
+}
+
+void GLAD_API_PTR recBindFragDataLocation(GLuint program, GLuint color, const GLchar* name)
+{
+    begin(OP_BindFragDataLocation);
+    put(program);
+    put(color);
+    putString(name);
+    real_BindFragDataLocation(program, color, name);
+}
+
+GLint GLAD_API_PTR recGetUniformLocation(GLuint program, const GLchar* name)
+{
+    GLint location = real_GetUniformLocation(program, name);
+    begin(OP_GetUniformLocation);
+    put(program);
+    putString(name);
+    put(location);
+    return location;
+}
+
+GLuint GLAD_API_PTR recGetUniformBlockIndex(GLuint program, const GLchar* name)
+{
+    GLuint index = real_GetUniformBlockIndex(program, name);
+    begin(OP_GetUniformBlockIndex);
+    put(program);
+    putString(name);
+    put(index);
+    return index;
+}
+
+void GLAD_API_PTR recBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    begin(OP_BufferData);
+    put(target);
+    put(size);
+    put(usage);
+    putBlob(data, data ? (size_t)size : 0);
+    real_BufferData(target, size, data, usage);
+}
+
+void GLAD_API_PTR recBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    begin(OP_BufferSubData);
+    put(target);
+    put(offset);
+    putBlob(data, (size_t)size);
+    real_BufferSubData(target, offset, size, data);
+}
+
+void GLAD_API_PTR recTexImage2D(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+    GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    begin(OP_TexImage2D);
+    put(target);
+    put(level);
+    put(internal_format);
+    put(width);
+    put(height);
+    put(border);
+    put(format);
+    put(type);
+    // pixels from an unpack buffer are an offset, not client memory
+    bool offset = unpackBufferBound();
+    put((uint32_t)offset);
+    if (offset) put(pixels);
+    else putBlob(pixels, pixels ? imageBytes(width, height, format, type) : 0);
+    real_TexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+}
+
+void GLAD_API_PTR recTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* pixels)
+{
+    begin(OP_TexSubImage2D);
+    put(target);
+    put(level);
+    put(x);
+    put(y);
+    put(width);
+    put(height);
+    put(format);
+    put(type);
+    bool offset = unpackBufferBound();
+    put((uint32_t)offset);
+    if (offset) put(pixels);
+    else putBlob(pixels, pixels ? imageBytes(width, height, format, type) : 0);
+    real_TexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+}
+
+#define X(name, type, n) \
+    void GLAD_API_PTR rec##name(GLint location, GLsizei count, const type* values) \
+    { \
+        begin(OP_##name); \
+        put(location); \
+        putBlob(values, sizeof(type) * n * count); \
+        real_##name(location, count, values); \
+    }
+CGE_GL_UNIFORM_VECTOR_CALLS(X)
+#undef X
+
+#define X(name, n) \
+    void GLAD_API_PTR rec##name(GLint location, GLsizei count, GLboolean transpose, const GLfloat* values) \
+    { \
+        begin(OP_##name); \
+        put(location); \
+        put(transpose); \
+        putBlob(values, sizeof(GLfloat) * n * count); \
+        real_##name(location, count, transpose, values); \
+    }
+CGE_GL_UNIFORM_MATRIX_CALLS(X)
+#undef X
+
+void* GLAD_API_PTR recMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    void* ptr = real_MapBufferRange(target, offset, length, access);
+    if (ptr && (access & GL_MAP_WRITE_BIT))
+    {
+        Mapping mapping = { target, offset, length, access, ptr };
+        rec.mappings.push_back(mapping);
+    }
+    return ptr;
+}
+
+GLboolean GLAD_API_PTR recUnmapBuffer(GLenum target)
+{
+    // the writes are done by now, store them as they landed
+    for (size_t i = rec.mappings.size(); i-- > 0;)
+    {
+        const Mapping& mapping = rec.mappings[i];
+        if (mapping.target != target) continue;
+        begin(OP_MappedWrite);
+        put(mapping.target);
+        put(mapping.offset);
+        put(mapping.access);
+        putBlob(mapping.ptr, (size_t)mapping.length);
+        rec.mappings.erase(rec.mappings.begin() + i);
+        break;
+    }
+    return real_UnmapBuffer(target);
+}
+
+GLsync GLAD_API_PTR recFenceSync(GLenum condition, GLbitfield flags)
+{
+    GLsync sync = real_FenceSync(condition, flags);
+    uint32_t id = rec.next_sync++;
+    rec.syncs[sync] = id;
+    begin(OP_FenceSync);
+    put(condition);
+    put(flags);
+    put(id);
+    return sync;
+}
+
+uint32_t syncId(GLsync sync)
+{
+    auto it = rec.syncs.find(sync);
+    return it == rec.syncs.end() ? 0 : it->second;
+}
+
+GLenum GLAD_API_PTR recClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    begin(OP_ClientWaitSync);
+    put(syncId(sync));
+    put(flags);
+    put(timeout);
+    return real_ClientWaitSync(sync, flags, timeout);
+}
+
+void GLAD_API_PTR recWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    begin(OP_WaitSync);
+    put(syncId(sync));
+    put(flags);
+    put(timeout);
+    real_WaitSync(sync, flags, timeout);
+}
+
+void GLAD_API_PTR recDeleteSync(GLsync sync)
+{
+    begin(OP_DeleteSync);
+    put(syncId(sync));
+    rec.syncs.erase(sync);
+    real_DeleteSync(sync);
+}
+
+}
+
+GLRecorder& GLRecorder::Instance()
+{
+    static GLRecorder recorder;
+    return recorder;
+}
+
+GLRecorder::GLRecorder():
+    _recording(false),
+    _frames_left(0),
+    _bytes(0)
+{
+}
+
+bool GLRecorder::start(const std::string& path, int frames, int width, int height)
+{
+    if (_recording) return false;
+    rec.file = fopen(path.c_str(), "wb");
+    if (!rec.file)
+    {
+        std::cout << "Cannot write GL capture " << path << std::endl;
+        return false;
+    }
+    rec.buffer.clear();
+    putRaw(kMagic, sizeof(kMagic));
+    putVarint(kVersion);
+    putVarint((uint64_t)width);
+    putVarint((uint64_t)height);
+
+#define X(name, kinds) hookPlain<OP_##name>(glad_gl##name);
+    CGE_GL_PLAIN_CALLS(X)
+#undef X
+#define X(name, kind) \
+    hook(glad_glGen##name, Objects<OP_Gen##name, OP_Delete##name>::gen, &Objects<OP_Gen##name, OP_Delete##name>::genCall); \
+    hook(glad_glDelete##name, Objects<OP_Gen##name, OP_Delete##name>::del, &Objects<OP_Gen##name, OP_Delete##name>::delCall);
+    CGE_GL_OBJECT_CALLS(X)
+#undef X
+#define CGE_GL_HOOK(name) hook(glad_gl##name, real_##name, &rec##name);
+#define X(name, ...) CGE_GL_HOOK(name)
+    CGE_GL_UNIFORM_VECTOR_CALLS(X)
+    CGE_GL_UNIFORM_MATRIX_CALLS(X)
+#undef X
+    CGE_GL_HOOK(CreateShader)
+    CGE_GL_HOOK(CreateProgram)
+    CGE_GL_HOOK(ShaderSource)
+    CGE_GL_HOOK(BindAttribLocation)
+    CGE_GL_HOOK(BindFragDataLocation)
+    CGE_GL_HOOK(GetUniformLocation)
+    CGE_GL_HOOK(GetUniformBlockIndex)
+    CGE_GL_HOOK(BufferData)
+    CGE_GL_HOOK(BufferSubData)
+    CGE_GL_HOOK(TexImage2D)
+    CGE_GL_HOOK(TexSubImage2D)
+    CGE_GL_HOOK(MapBufferRange)
+    CGE_GL_HOOK(UnmapBuffer)
+    CGE_GL_HOOK(FenceSync)
+    CGE_GL_HOOK(ClientWaitSync)
+    CGE_GL_HOOK(WaitSync)
+    CGE_GL_HOOK(DeleteSync)
+#undef CGE_GL_HOOK
+
+    _recording = true;
+    _frames_left = frames;
+    _bytes = 0;
+    return true;
+}
+
+void GLRecorder::endFrame()
+{
+    if (!_recording) return;
+    begin(OP_FRAME);
+    fwrite(rec.buffer.data(), 1, rec.buffer.size(), rec.file);
+    _bytes += rec.buffer.size();
+    rec.buffer.clear();
+    if (_frames_left > 0 && --_frames_left == 0) stop();
+}
+
+void GLRecorder::stop()
+{
+    if (!_recording) return;
+    for (auto& restore : rec.restore) restore();
+    rec.restore.clear();
+    fwrite(rec.buffer.data(), 1, rec.buffer.size(), rec.file);
+    _bytes += rec.buffer.size();
+    rec.buffer.clear();
+    fclose(rec.file);
+    rec.file = nullptr;
+    rec.mappings.clear();
+    rec.syncs.clear();
+    _recording = false;
+    std::cout << "GL capture written, " << _bytes / 1024 << " KB" << std::endl;
+}
+
+// ---------------------------------------------------------------------------
+// replay
+
+GLReplay::GLReplay():
+    _begin(0),
+    _pos(0),
+    _width(0),
+    _height(0),
+    _error(false),
+    _upload_bytes(0),
+    _current_program(0),
+    _call_program(0)
+{
+}
+
+bool GLReplay::open(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    _data.resize(size > 0 ? (size_t)size : 0);
+    size_t read = fread(_data.data(), 1, _data.size(), file);
+    fclose(file);
+    if (read != _data.size() || _data.size() < sizeof(kMagic) || memcmp(_data.data(), kMagic, sizeof(kMagic)))
+    {
+        std::cout << path << " is not a GL capture" << std::endl;
+        return false;
+    }
+    _pos = sizeof(kMagic);
+    _error = false;
+    if (varint() != kVersion)
+    {
+        std::cout << path << ": unsupported capture version" << std::endl;
+        return false;
+    }
+    _width = (int)varint();
+    _height = (int)varint();
+    _begin = _pos;
+    return !_error;
+}
+
+uint64_t GLReplay::varint()
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (_pos >= _data.size())
+        {
+            _error = true;
+            return 0;
+        }
+        uint8_t byte = _data[_pos++];
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return v;
+}
+
+int64_t GLReplay::zigzag()
+{
+    uint64_t v = varint();
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+void GLReplay::raw(void* out, size_t size)
+{
+    if (_pos + size > _data.size())
+    {
+        _error = true;
+        memset(out, 0, size);
+        return;
+    }
+    memcpy(out, &_data[_pos], size);
+    _pos += size;
+}
+
+template <typename T>
+T GLReplay::get()
+{
+    T value;
+    if (std::is_floating_point<T>::value) raw(&value, sizeof(value));
+    else if (std::is_pointer<T>::value) value = (T)(uintptr_t)varint();
+    else if (std::is_signed<T>::value) value = (T)zigzag();
+    else value = (T)varint();
+    return value;
+}
+
+const uint8_t* GLReplay::blob(size_t* size)
+{
+    *size = (size_t)varint();
+    if (_pos + *size > _data.size())
+    {
+        _error = true;
+        *size = 0;
+        return nullptr;
+    }
+    const uint8_t* data = *size ? &_data[_pos] : nullptr;
+    _pos += *size;
+    _upload_bytes += *size;
+    return data;
+}
+
+std::unordered_map<uint32_t, uint32_t>& GLReplay::names(char kind)
+{
+    return _names[strchr(kNameKinds, kind) - kNameKinds];
+}
+
+uint32_t GLReplay::name(char kind, uint32_t recorded)
+{
+    if (!recorded) return 0;
+    auto& map = names(kind);
+    auto it = map.find(recorded);
+    return it == map.end() ? recorded : it->second;
+}
+
+int64_t GLReplay::remap(char kind, int64_t value)
+{
+    switch (kind)
+    {
+    case 'P':
+        _call_program = (uint32_t)value;
+        return name(kind, (uint32_t)value);
+    case 'U':
+    {
+        auto it = _uniforms.find((uint64_t)_current_program << 32 | (uint32_t)value);
+        return it == _uniforms.end() ? value : it->second;
+    }
+    case 'I':
+    {
+        auto it = _blocks.find((uint64_t)_call_program << 32 | (uint32_t)value);
+        return it == _blocks.end() ? value : it->second;
+    }
+    default:
+        return name(kind, (uint32_t)value);
+    }
+}
+
+template <typename T>
+T GLReplay::arg(char kind)
+{
+    T value = get<T>();
+    return kind == 'v' ? value : (T)remap(kind, (int64_t)value);
+}
+
+template <typename... A>
+void GLReplay::plain(void (GLAD_API_PTR *fn)(A...), const char* kinds)
+{
+    plain(fn, kinds, std::index_sequence_for<A...>());
+}
+
+template <typename... A, size_t... I>
+void GLReplay::plain(void (GLAD_API_PTR *fn)(A...), const char* kinds, std::index_sequence<I...>)
+{
+    // braced initialisers evaluate left to right, in stream order
+    std::tuple<A...> args{ arg<A>(kinds[I])... };
+    if (!_error) fn(std::get<I>(args)...);
+}
+
+bool GLReplay::replayFrame(GLReplayFrame* stats)
+{
+    uint32_t calls = 0;
+    _upload_bytes = 0;
+    while (_pos < _data.size() && !_error)
+    {
+        int op = (int)varint();
+        calls++;
+        switch (op)
+        {
+        case OP_FRAME:
+            if (stats)
+            {
+                stats->calls = calls - 1;
+                stats->bytes = _upload_bytes;
+            }
+            return true;
+#define X(name, kinds) case OP_##name: plain(glad_gl##name, kinds); break;
+        CGE_GL_PLAIN_CALLS(X)
+#undef X
+#define X(objects, kind) \
+        case OP_Gen##objects: \
+        { \
+            GLsizei n = get<GLsizei>(); \
+            std::vector<GLuint> out(n > 0 ? n : 0); \
+            glGen##objects(n, out.data()); \
+            for (GLsizei i = 0; i < n; i++) names(kind)[get<GLuint>()] = out[i]; \
+            break; \
+        } \
+        case OP_Delete##objects: \
+        { \
+            GLsizei n = get<GLsizei>(); \
+            std::vector<GLuint> list(n > 0 ? n : 0); \
+            for (GLsizei i = 0; i < n; i++) \
+            { \
+                GLuint recorded = get<GLuint>(); \
+                list[i] = name(kind, recorded); \
+                names(kind).erase(recorded); \
+            } \
+            glDelete##objects(n, list.data()); \
+            break; \
+        }
+        CGE_GL_OBJECT_CALLS(X)
+#undef X
+#define X(name, type, n) \
+        case OP_##name: \
+        { \
+            GLint location = arg<GLint>('U'); \
+            size_t size; \
+            const uint8_t* values = blob(&size); \
+            gl##name(location, (GLsizei)(size / (sizeof(type) * n)), (const type*)values); \
+            break; \
+        }
+        CGE_GL_UNIFORM_VECTOR_CALLS(X)
+#undef X
+#define X(name, n) \
+        case OP_##name: \
+        { \
+            GLint location = arg<GLint>('U'); \
+            GLboolean transpose = get<GLboolean>(); \
+            size_t size; \
+            const uint8_t* values = blob(&size); \
+            gl##name(location, (GLsizei)(size / (sizeof(GLfloat) * n)), transpose, (const GLfloat*)values); \
+            break; \
+        }
+        CGE_GL_UNIFORM_MATRIX_CALLS(X)
+#undef X
+        case OP_CreateShader:
+        {
+            GLenum type = get<GLenum>();
+            names('P')[get<GLuint>()] = glCreateShader(type);
+            break;
+        }
+        case OP_CreateProgram:
+            names('P')[get<GLuint>()] = glCreateProgram();
+            break;
+        case OP_ShaderSource:
+        {
+            GLuint shader = arg<GLuint>('P');
+            GLsizei count = get<GLsizei>();
+            std::vector<const GLchar*> strings;
+            std::vector<GLint> lengths;
+            for (GLsizei i = 0; i < count; i++)
+            {
+                size_t size;
+                const uint8_t* text = blob(&size);
+                strings.push_back((const GLchar*)text);
+                lengths.push_back((GLint)size);
+            }
+            glShaderSource(shader, count, strings.data(), lengths.data());
+            break;
+        }
+        case OP_BindAttribLocation:
+        case OP_BindFragDataLocation:
+        {
+            GLuint program = arg<GLuint>('P');
+            GLuint index = get<GLuint>();
+            size_t size;
+            const uint8_t* text = blob(&size);
+            std::string attribute((const char*)text, size);
+            if (op == OP_BindAttribLocation) glBindAttribLocation(program, index, attribute.c_str());
+            else glBindFragDataLocation(program, index, attribute.c_str());
+            break;
+        }
+        case OP_GetUniformLocation:
+        case OP_GetUniformBlockIndex:
+        {
+            uint32_t recorded_program = get<GLuint>();
+            GLuint program = name('P', recorded_program);
+            size_t size;
+            const uint8_t* text = blob(&size);
+            std::string uniform((const char*)text, size);
+            uint64_t key = (uint64_t)recorded_program << 32;
+            if (op == OP_GetUniformLocation)
+                _uniforms[key | (uint32_t)get<GLint>()] = glGetUniformLocation(program, uniform.c_str());
+            else
+                _blocks[key | get<GLuint>()] = glGetUniformBlockIndex(program, uniform.c_str());
+            break;
+        }
+        case OP_BufferData:
+        {
+            GLenum target = get<GLenum>();
+            GLsizeiptr size = get<GLsizeiptr>();
+            GLenum usage = get<GLenum>();
+            size_t bytes;
+            const uint8_t* data = blob(&bytes);
+            glBufferData(target, size, bytes ? data : nullptr, usage);
+            break;
+        }
+        case OP_BufferSubData:
+        {
+            GLenum target = get<GLenum>();
+            GLintptr offset = get<GLintptr>();
+            size_t bytes;
+            const uint8_t* data = blob(&bytes);
+            glBufferSubData(target, offset, (GLsizeiptr)bytes, data);
+            break;
+        }
+        case OP_TexImage2D:
+        case OP_TexSubImage2D:
+        {
+            GLenum target = get<GLenum>();
+            GLint level = get<GLint>();
+            GLint internal_format = 0, x = 0, y = 0, border = 0;
+            if (op == OP_TexImage2D) internal_format = get<GLint>();
+            else
+            {
+                x = get<GLint>();
+                y = get<GLint>();
+            }
+            GLsizei width = get<GLsizei>();
+            GLsizei height = get<GLsizei>();
+            if (op == OP_TexImage2D) border = get<GLint>();
+            GLenum format = get<GLenum>();
+            GLenum type = get<GLenum>();
+            const void* pixels;
+            if (get<uint32_t>()) pixels = get<const void*>();
+            else
+            {
+                size_t bytes;
+                pixels = blob(&bytes);
+            }
+            if (op == OP_TexImage2D)
+                glTexImage2D(target, level, internal_format, width, height, border, format, type, pixels);
+            else
+                glTexSubImage2D(target, level, x, y, width, height, format, type, pixels);
+            break;
+        }
+        case OP_MappedWrite:
+        {
+            GLenum target = get<GLenum>();
+            GLintptr offset = get<GLintptr>();
+            GLbitfield access = get<GLbitfield>();
+            size_t bytes;
+            const uint8_t* data = blob(&bytes);
+            // same path as the engine, so the replay measures the map, not a glBufferSubData
+            void* ptr = glMapBufferRange(target, offset, (GLsizeiptr)bytes, access & ~GL_MAP_FLUSH_EXPLICIT_BIT);
+            if (ptr)
+            {
+                memcpy(ptr, data, bytes);
+                glUnmapBuffer(target);
+            }
+            break;
+        }
+        case OP_FenceSync:
+        {
+            GLenum condition = get<GLenum>();
+            GLbitfield flags = get<GLbitfield>();
+            _syncs[get<uint32_t>()] = glFenceSync(condition, flags);
+            break;
+        }
+        case OP_ClientWaitSync:
+        case OP_WaitSync:
+        {
+            auto it = _syncs.find(get<uint32_t>());
+            GLbitfield flags = get<GLbitfield>();
+            GLuint64 timeout = get<GLuint64>();
+            if (it == _syncs.end()) break;
+            if (op == OP_ClientWaitSync) glClientWaitSync(it->second, flags, timeout);
+            else glWaitSync(it->second, flags, timeout);
+            break;
+        }
+        case OP_DeleteSync:
+        {
+            auto it = _syncs.find(get<uint32_t>());
+            if (it == _syncs.end()) break;
+            glDeleteSync(it->second);
+            _syncs.erase(it);
+            break;
+        }
+        default:
+            std::cout << "Unknown GL capture opcode " << op << std::endl;
+            _error = true;
+            break;
+        }
+        if (op == OP_UseProgram) _current_program = _call_program;
+    }
+    if (stats)
+    {
+        stats->calls = calls;
+        stats->bytes = _upload_bytes;
+    }
+    return false;
+}
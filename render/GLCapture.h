@@ -0,0 +1,95 @@
+#ifndef _CGE_GL_CAPTURE_H_
+#define _CGE_GL_CAPTURE_H_
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace CGE
+{
+
+// GL command stream capture. While recording, the glad pointers of the calls
+// that change GL state point at wrappers that append the call to a compact
+// binary stream (varint integers, raw floats) before forwarding it. Buffer and
+// texture uploads, shader sources and writes through glMapBufferRange (taken
+// at glUnmapBuffer) are stored inline; object names, uniform locations and
+// fences are stored as the engine saw them and remapped on replay. Queries
+// and reads are not recorded, they do not change what gets drawn.
+//
+// Persistently mapped buffers are invisible to the recorder, call
+// disableBufferStorage() before anything creates one.
+class GLRecorder
+{
+public:
+    static GLRecorder& Instance();
+
+    // context thread, gladLoadGL must have run; frames > 0 stops by itself after that many
+    bool start(const std::string& path, int frames, int width, int height);
+    void stop();
+    // context thread, after each swap
+    void endFrame();
+
+    bool recording() const { return _recording; }
+    uint64_t bytes() const { return _bytes; }
+
+private:
+    GLRecorder();
+
+    bool _recording;
+    int _frames_left;
+    uint64_t _bytes;
+};
+
+struct GLReplayFrame
+{
+    uint32_t calls;
+    uint64_t bytes;     // uploads replayed
+};
+
+// Replays a capture on the current context, one frame per replayFrame().
+class GLReplay
+{
+public:
+    GLReplay();
+
+    bool open(const std::string& path);
+    int width() const { return _width; }
+    int height() const { return _height; }
+
+    // issues the calls up to the next frame marker, false once the stream ends
+    bool replayFrame(GLReplayFrame* stats = nullptr);
+
+private:
+    uint64_t varint();
+    int64_t zigzag();
+    void raw(void* out, size_t size);
+    template <typename T> T get();
+    template <typename T> T arg(char kind);
+    const uint8_t* blob(size_t* size);
+    template <typename... A> void plain(void (GLAD_API_PTR *fn)(A...), const char* kinds);
+    template <typename... A, size_t... I>
+    void plain(void (GLAD_API_PTR *fn)(A...), const char* kinds, std::index_sequence<I...>);
+    std::unordered_map<uint32_t, uint32_t>& names(char kind);
+    uint32_t name(char kind, uint32_t recorded);
+    int64_t remap(char kind, int64_t value);
+
+    std::vector<uint8_t> _data;
+    size_t _begin, _pos;
+    int _width, _height;
+    bool _error;
+    uint64_t _upload_bytes;
+
+    std::unordered_map<uint32_t, uint32_t> _names[7];      // B T V F R S P
+    std::unordered_map<uint64_t, GLint> _uniforms;          // recorded program << 32 | location
+    std::unordered_map<uint64_t, GLuint> _blocks;           // recorded program << 32 | block index
+    std::unordered_map<uint32_t, GLsync> _syncs;
+    uint32_t _current_program;      // recorded name, for uniform locations
+    uint32_t _call_program;         // last program argument of the call being decoded
+};
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include <cstring>
+
+#include "render/GLExt.h"
+#include <GLFW/glfw3.h>
+
+using namespace CGE;
+
+static GLExtensions s_ext;
+
+const GLExtensions& CGE::glExtensions()
+{
+    return s_ext;
+}
+
+bool CGE::hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && !strcmp(ext, name)) return true;
+    }
+    return false;
+}
+
+void CGE::loadGLExtensions()
+{
+    memset(&s_ext, 0, sizeof(s_ext));
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    s_ext.version = major * 100 + minor * 10;
+
+    s_ext.sync = s_ext.version >= 320 || hasGLExtension("GL_ARB_sync");
+    if (s_ext.version >= 440 || hasGLExtension("GL_ARB_buffer_storage"))
+    {
+        s_ext.BufferStorage = (PFN_BufferStorage)glfwGetProcAddress("glBufferStorage");
+        s_ext.buffer_storage = s_ext.BufferStorage != nullptr;
+    }
+    if (s_ext.version >= 410 || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        // drivers may expose the entry points with no format to save in
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        s_ext.GetProgramBinary = (PFN_GetProgramBinary)glfwGetProcAddress("glGetProgramBinary");
+        s_ext.ProgramBinary = (PFN_ProgramBinary)glfwGetProcAddress("glProgramBinary");
+        s_ext.ProgramParameteri = (PFN_ProgramParameteri)glfwGetProcAddress("glProgramParameteri");
+        s_ext.program_binary = formats > 0 && s_ext.GetProgramBinary && s_ext.ProgramBinary && s_ext.ProgramParameteri;
+    }
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        s_ext.MaxShaderCompilerThreads = (PFN_MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        s_ext.MaxShaderCompilerThreads = (PFN_MaxShaderCompilerThreads)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    s_ext.parallel_shader_compile = s_ext.MaxShaderCompilerThreads != nullptr;
+}
+
+void CGE::disableBufferStorage()
+{
+    s_ext.buffer_storage = false;
+    s_ext.BufferStorage = nullptr;
+}
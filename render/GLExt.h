@@ -0,0 +1,59 @@
+#ifndef _CGE_GL_EXT_H_
+#define _CGE_GL_EXT_H_
+
+#include <glad/gl.h>
+
+// Entry points newer than the GL 3.3 core the vendored glad was generated for.
+// Loaded by loadGLExtensions() once a context is current, null when unsupported.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace CGE
+{
+
+typedef void (GLAD_API_PTR *PFN_BufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (GLAD_API_PTR *PFN_GetProgramBinary)(GLuint program, GLsizei size, GLsizei* length, GLenum* format, void* binary);
+typedef void (GLAD_API_PTR *PFN_ProgramBinary)(GLuint program, GLenum format, const void* binary, GLsizei length);
+typedef void (GLAD_API_PTR *PFN_ProgramParameteri)(GLuint program, GLenum name, GLint value);
+typedef void (GLAD_API_PTR *PFN_MaxShaderCompilerThreads)(GLuint count);
+
+struct GLExtensions
+{
+    int version;                // major * 100 + minor * 10, as the ImGui backend does
+    bool buffer_storage;        // GL 4.4 / ARB_buffer_storage
+    bool sync;                  // GL 3.2 / ARB_sync
+    bool program_binary;        // GL 4.1 / ARB_get_program_binary with at least one binary format
+    bool parallel_shader_compile;   // KHR/ARB_parallel_shader_compile, GL_COMPLETION_STATUS_KHR queries
+
+    PFN_BufferStorage BufferStorage;
+    PFN_GetProgramBinary GetProgramBinary;
+    PFN_ProgramBinary ProgramBinary;
+    PFN_ProgramParameteri ProgramParameteri;
+    PFN_MaxShaderCompilerThreads MaxShaderCompilerThreads;
+};
+
+// the current context's capabilities, valid after loadGLExtensions()
+const GLExtensions& glExtensions();
+void loadGLExtensions();
+// after loadGLExtensions(), for tools that cannot see writes through persistent mappings
+void disableBufferStorage();
+bool hasGLExtension(const char* name);
+
+}
+
+#endif
@@ -0,0 +1,233 @@
+#include "render/GLState.h"
+
+using namespace CGE;
+
+GLStateCache::GLStateCache()
+{
+    _counters.issued = _counters.elided = 0;
+    invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+    _program = kUnknown;
+    _vao = kUnknown;
+    for (GLuint& b : _buffers) b = kUnknown;
+    for (Range& r : _uniform_buffers) r.buffer = kUnknown;
+    _active_unit = kUnknown;
+    for (Texture& t : _textures)
+    {
+        t.target = 0;
+        t.texture = kUnknown;
+    }
+    _framebuffer = kUnknown;
+    _blend = -1;
+    _blend_src = _blend_dst = 0;
+    _depth_test = _depth_write = -1;
+    _depth_func = 0;
+    _cull = -1;
+    _cull_face = 0;
+    _viewport[0] = _viewport[1] = -1;
+    _viewport[2] = _viewport[3] = -1;
+}
+
+int GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER: return ARRAY_BUFFER;
+    case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_BUFFER;
+    case GL_UNIFORM_BUFFER: return UNIFORM_BUFFER;
+    case GL_PIXEL_PACK_BUFFER: return PIXEL_PACK;
+    case GL_PIXEL_UNPACK_BUFFER: return PIXEL_UNPACK;
+    default: return -1;
+    }
+}
+
+void GLStateCache::useProgram(GLuint program)
+{
+    if (changed(_program != program))
+    {
+        _program = program;
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao)
+{
+    if (changed(_vao != vao))
+    {
+        _vao = vao;
+        glBindVertexArray(vao);
+        // the element buffer binding lives in the VAO
+        _buffers[ELEMENT_BUFFER] = kUnknown;
+    }
+}
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = bufferSlot(target);
+    if (slot < 0)
+    {
+        _counters.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (changed(_buffers[slot] != buffer))
+    {
+        _buffers[slot] = buffer;
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::bindUniformBuffer(GLuint index, GLuint buffer)
+{
+    bindUniformBufferRange(index, buffer, 0, -1);
+}
+
+void GLStateCache::bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (index >= kBufferBindings)
+    {
+        _counters.issued++;
+        if (size < 0) glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+        else glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+        _buffers[UNIFORM_BUFFER] = buffer;
+        return;
+    }
+    Range& r = _uniform_buffers[index];
+    if (changed(r.buffer != buffer || r.offset != offset || r.size != size))
+    {
+        r.buffer = buffer;
+        r.offset = offset;
+        r.size = size;
+        if (size < 0) glBindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+        else glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+        // indexed binds also change the generic binding point
+        _buffers[UNIFORM_BUFFER] = buffer;
+    }
+}
+
+void GLStateCache::activeTexture(GLuint unit)
+{
+    if (changed(_active_unit != unit))
+    {
+        _active_unit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    if (unit >= kTextureUnits)
+    {
+        _counters.issued += 2;
+        _active_unit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        return;
+    }
+    Texture& t = _textures[unit];
+    if (t.target == target && t.texture == texture)
+    {
+        _counters.elided++;
+        return;
+    }
+    activeTexture(unit);
+    _counters.issued++;
+    t.target = target;
+    t.texture = texture;
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindFramebuffer(GLuint framebuffer)
+{
+    if (changed(_framebuffer != framebuffer))
+    {
+        _framebuffer = framebuffer;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+void GLStateCache::setBlend(bool enable, GLenum src, GLenum dst)
+{
+    if (changed(_blend != (int)enable))
+    {
+        _blend = enable;
+        if (enable) glEnable(GL_BLEND);
+        else glDisable(GL_BLEND);
+    }
+    if (!enable) return;
+    if (changed(_blend_src != src || _blend_dst != dst))
+    {
+        _blend_src = src;
+        _blend_dst = dst;
+        glBlendFunc(src, dst);
+    }
+}
+
+void GLStateCache::setDepth(bool test, bool write, GLenum func)
+{
+    if (changed(_depth_test != (int)test))
+    {
+        _depth_test = test;
+        if (test) glEnable(GL_DEPTH_TEST);
+        else glDisable(GL_DEPTH_TEST);
+    }
+    if (changed(_depth_write != (int)write))
+    {
+        _depth_write = write;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+    if (test && changed(_depth_func != func))
+    {
+        _depth_func = func;
+        glDepthFunc(func);
+    }
+}
+
+void GLStateCache::setCull(bool enable, GLenum face)
+{
+    if (changed(_cull != (int)enable))
+    {
+        _cull = enable;
+        if (enable) glEnable(GL_CULL_FACE);
+        else glDisable(GL_CULL_FACE);
+    }
+    if (enable && changed(_cull_face != face))
+    {
+        _cull_face = face;
+        glCullFace(face);
+    }
+}
+
+void GLStateCache::setViewport(GLint x, GLint y, GLsizei w, GLsizei h)
+{
+    if (changed(_viewport[0] != x || _viewport[1] != y || _viewport[2] != w || _viewport[3] != h))
+    {
+        _viewport[0] = x;
+        _viewport[1] = y;
+        _viewport[2] = w;
+        _viewport[3] = h;
+        glViewport(x, y, w, h);
+    }
+}
+
+void GLStateCache::forgetBuffer(GLuint buffer)
+{
+    for (GLuint& b : _buffers)
+        if (b == buffer) b = kUnknown;
+    for (Range& r : _uniform_buffers)
+        if (r.buffer == buffer) r.buffer = kUnknown;
+}
+
+void GLStateCache::forgetTexture(GLuint texture)
+{
+    for (Texture& t : _textures)
+        if (t.texture == texture) t.texture = kUnknown;
+}
+
+void GLStateCache::forgetFramebuffer(GLuint framebuffer)
+{
+    if (_framebuffer == framebuffer) _framebuffer = kUnknown;
+}
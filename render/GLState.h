@@ -0,0 +1,90 @@
+#ifndef _CGE_GL_STATE_H_
+#define _CGE_GL_STATE_H_
+
+#include <glad/gl.h>
+#include <cstdint>
+
+namespace CGE
+{
+
+struct GLStateCounters
+{
+    uint64_t issued;    // calls that reached the driver
+    uint64_t elided;    // calls skipped because the state was already set
+};
+
+// Shadow copy of the GL state the engine touches. Setters compare against the
+// shadow and only call into GL on a change. Anything that changes GL state
+// behind the cache's back (foreign code, other contexts) must be followed by
+// invalidate().
+class GLStateCache
+{
+public:
+    static const int kTextureUnits = 16;
+    static const int kBufferBindings = 16;
+
+    GLStateCache();
+
+    // forget everything, the next call of each setter goes to GL
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    // GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER
+    void bindBuffer(GLenum target, GLuint buffer);
+    // indexed uniform block bindings, glBindBufferBase / glBindBufferRange
+    void bindUniformBuffer(GLuint index, GLuint buffer);
+    void bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    void bindFramebuffer(GLuint framebuffer);
+
+    void setBlend(bool enable, GLenum src = GL_SRC_ALPHA, GLenum dst = GL_ONE_MINUS_SRC_ALPHA);
+    void setDepth(bool test, bool write = true, GLenum func = GL_LESS);
+    void setCull(bool enable, GLenum face = GL_BACK);
+    void setViewport(GLint x, GLint y, GLsizei w, GLsizei h);
+
+    // buffer deletion must drop stale bindings, names get reused
+    void forgetBuffer(GLuint buffer);
+    void forgetTexture(GLuint texture);
+    void forgetFramebuffer(GLuint framebuffer);
+
+    const GLStateCounters& counters() const { return _counters; }
+    void resetCounters() { _counters.issued = _counters.elided = 0; }
+
+private:
+    enum BufferSlot { ARRAY_BUFFER = 0, ELEMENT_BUFFER, UNIFORM_BUFFER, PIXEL_PACK, PIXEL_UNPACK, BUFFER_SLOTS };
+    static int bufferSlot(GLenum target);
+    bool changed(bool differs)
+    {
+        if (differs) _counters.issued++;
+        else _counters.elided++;
+        return differs;
+    }
+    void activeTexture(GLuint unit);
+
+    static const GLuint kUnknown = 0xffffffffu;
+    struct Range { GLuint buffer; GLintptr offset; GLsizeiptr size; };
+    struct Texture { GLenum target; GLuint texture; };
+
+    GLuint _program;
+    GLuint _vao;
+    GLuint _buffers[BUFFER_SLOTS];
+    Range _uniform_buffers[kBufferBindings];
+    GLuint _active_unit;
+    Texture _textures[kTextureUnits];
+    GLuint _framebuffer;
+
+    int _blend;             // -1 unknown
+    GLenum _blend_src, _blend_dst;
+    int _depth_test, _depth_write;
+    GLenum _depth_func;
+    int _cull;
+    GLenum _cull_face;
+    GLint _viewport[4];
+
+    GLStateCounters _counters;
+};
+
+}
+
+#endif
@@ -1,11 +1,21 @@
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 #include "utils/ImGuiFileDialog.h"
 #include "utils/utils.h"
+#include "utils/MeshImport.h"
 #include "render/MiniGL.h"
+#include "render/Profiler.h"
+#include "render/GLExt.h"
+#include "render/GLCapture.h"
+#include "render/ShaderSource.h"
+#include "render/VertexFormat.h"
 
 #define IMGUI_HAS_VIEWPORT
 
@@ -16,28 +26,183 @@ static void glfw_error_callback(int error, const char* description)
     std::cout << "GLFW Error" << error << ":" << description <<std::endl;
 }
 
-MiniGL::MiniGL():
-    _display_w(1280), 
-    _display_h(720),
-    _open_dialog(false)
+MiniGLOptions MiniGLOptions::parse(int argc, char** argv)
 {
+    MiniGLOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--headless"))
+            options.headless = true;
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            options.frames = std::max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--size") && i + 1 < argc)
+        {
+            int width = 0, height = 0;
+            if (sscanf(argv[++i], "%dx%d", &width, &height) == 2 && width > 0 && height > 0)
+            {
+                options.width = width;
+                options.height = height;
+            }
+            else
+                std::cout << "Bad size: " << argv[i] << ", expected WIDTHxHEIGHT" << std::endl;
+        }
+        else if (!strcmp(argv[i], "--hz") && i + 1 < argc)
+            options.fixed_hz = std::max(1.0, atof(argv[++i]));
+        else if (!strcmp(argv[i], "--max-steps") && i + 1 < argc)
+            options.max_catchup_steps = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--profile-csv") && i + 1 < argc)
+            options.profile_csv = argv[++i];
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+            options.trace_frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--trace-file") && i + 1 < argc)
+            options.trace_file = argv[++i];
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            options.threads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--single-thread"))
+            options.render_thread = false;
+        else if (!strcmp(argv[i], "--cull-bench") && i + 1 < argc)
+            options.cull_bench = (size_t)std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+            options.capture_frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--capture-prefix") && i + 1 < argc)
+            options.capture_prefix = argv[++i];
+        else if (!strcmp(argv[i], "--capture-raw"))
+            options.capture_raw = true;
+        else if (!strcmp(argv[i], "--capture-scene"))
+            options.capture_scene = true;
+        else if (!strcmp(argv[i], "--gl-capture") && i + 1 < argc)
+            options.gl_capture_frames = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--gl-capture-file") && i + 1 < argc)
+            options.gl_capture_file = argv[++i];
+        else if (!strcmp(argv[i], "--shader-cache") && i + 1 < argc)
+            options.shader_cache = argv[++i];
+        else if (!strcmp(argv[i], "--no-shader-cache"))
+            options.shader_cache.clear();
+        else if (!strcmp(argv[i], "--no-shader-reload"))
+            options.shader_reload = false;
+        else if (!strcmp(argv[i], "--fixed-res"))
+            options.dynamic_resolution = false;
+        else if (!strcmp(argv[i], "--min-scale") && i + 1 < argc)
+            options.min_scale = std::min(1.0f, std::max(0.1f, (float)atof(argv[++i])));
+        else
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+    }
+    return options;
+}
+
+static void nameWorker(unsigned index)
+{
+    Profiler::Instance().setThreadName(("Worker " + std::to_string(index)).c_str());
+}
+
+MiniGL::MiniGL(const MiniGLOptions& options):
+    _options(options),
+    _jobs(options.threads ? (int)options.threads - 1 : -1, nameWorker),
+    _window(nullptr),
+    _display_w(options.width), 
+    _display_h(options.height),
+    _open_dialog(false),
+    _show_profiler(true),
+    _scene_count(0),
+    _frame_index(0),
+    _clear_color(0.45f, 0.55f, 0.60f, 1.00f),
+    _scene_w(0),
+    _scene_h(0),
+    _dynamic_resolution(options.dynamic_resolution),
+    _accumulator(0.0),
+    _alpha(0.0),
+    _sim_time(0.0),
+    _last_steps(0),
+    _dropped_steps(0),
+    _offscreen_fbo(0),
+    _offscreen_color(0),
+    _offscreen_depth(0)
+{
+    memset(&_queue_stats, 0, sizeof(_queue_stats));
+    memset(&_gl_counters, 0, sizeof(_gl_counters));
+    _stream_used = _stream_frame_size = 0;
+    _stream_mode = StreamBuffer::MODE_NONE;
+    memset(&_debug_stats, 0, sizeof(_debug_stats));
+    _target_count = _target_memory = _target_allocations = 0;
+    _resolution_scale = 1.0f;
+    _resolution_ms = 0.0;
+    _resolution.options().min_scale = options.min_scale;
+    _shaders_pending = -1;
+    memset(&_capture_stats, 0, sizeof(_capture_stats));
     init();
 }
 
+MiniGL::~MiniGL()
+{
+    if (_window == nullptr) 
+    {
+        glfwTerminate();
+        return;
+    }
+    GLRecorder::Instance().stop();
+    if (_offscreen_fbo)
+    {
+        glDeleteFramebuffers(1, &_offscreen_fbo);
+        glDeleteRenderbuffers(1, &_offscreen_color);
+        glDeleteRenderbuffers(1, &_offscreen_depth);
+    }
+    _debug_renderer.destroy();
+    ShaderCache::Instance().destroy();
+    _capture.destroy();
+    _targets.destroy();
+    _stream.destroy();
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+    glfwDestroyWindow(_window);
+    glfwTerminate();
+}
+
 void MiniGL::init()
 {
     glfwSetErrorCallback(glfw_error_callback);
-    if (!glfwInit()) return;
+    if (!glfwInit()) 
+    {
+#ifndef CGE_HEADLESS
+        if (_options.headless)
+            std::cout << "No display available, rebuild with -DCGE_HEADLESS=ON for the null platform" << std::endl;
+#endif
+        return;
+    }
     // GL 3.0 + GLSL 130
     const char* glsl_version = "#version 130";
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    if (_options.headless)
+    {
+        // OSMesa renders in software, so no GPU or display is needed
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
 
     // Create window with graphics context
-    _window = glfwCreateWindow(1280, 720, "Game Engine 1.0", nullptr, nullptr);
+    _window = glfwCreateWindow(_options.width, _options.height, "Game Engine 1.0", nullptr, nullptr);
     if (_window == nullptr) return;
     glfwMakeContextCurrent(_window);
-    glfwSwapInterval(1); // Enable vsync
+    if (!gladLoadGL(glfwGetProcAddress))
+    {
+        std::cout << "Failed to load OpenGL functions" << std::endl;
+        glfwDestroyWindow(_window);
+        _window = nullptr;
+        return;
+    }
+    loadGLExtensions();
+    if (_options.gl_capture_frames > 0)
+    {
+        // from before any object exists, so the replay can create them all;
+        // persistent mappings would hide their writes from the recorder
+        disableBufferStorage();
+        GLRecorder::Instance().start(_options.gl_capture_file, _options.gl_capture_frames,
+            _options.width, _options.height);
+    }
+    // Enable vsync, a headless run should go as fast as it can
+    glfwSwapInterval(_options.headless ? 0 : 1);
+    if (_options.headless) initOffscreen();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -46,14 +211,54 @@ void MiniGL::init()
     ImGui_ImplGlfw_InitForOpenGL(_window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
+    // dynamic geometry, ImGui vertices included
+    _stream.init(8 << 20, &_gl_state);
+    _debug_renderer.init();
+    _targets.init(&_gl_state);
+    _capture.init(&_gl_state);
+
     // shaders for geometry
-    // initShaders();
+    initShaders();
 }
 
-void MiniGL::initShaders()
+void MiniGL::initOffscreen()
 {
-    m_shader = Shader::Find("./resources/shader/unlit");
+    glGenRenderbuffers(1, &_offscreen_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, _offscreen_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _options.width, _options.height);
+    glGenRenderbuffers(1, &_offscreen_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, _offscreen_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _options.width, _options.height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &_offscreen_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _offscreen_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _offscreen_color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _offscreen_depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Offscreen framebuffer incomplete" << std::endl;
+}
 
+void MiniGL::initShaders()
+{
+    ShaderCache& cache = ShaderCache::Instance();
+    // programs loaded from binaries bypass glShaderSource, a GL capture could not replay them
+    cache.init(_options.gl_capture_frames > 0 ? std::string() : _options.shader_cache);
+    std::string dir = "./resources/shader";
+#if defined(CGE_EMBED_SHADERS)
+    // shipping builds read the sources compiled in, nothing from disk and no hot reload
+    setEmbeddedShaderRoot(dir);
+#elif defined(CGE_SHADER_SOURCE_DIR)
+    // watch and load the sources, not the copy CMake made at configure time
+    if (_options.shader_reload && _shader_watcher.watch(CGE_SHADER_SOURCE_DIR)) dir = CGE_SHADER_SOURCE_DIR;
+#endif
+    // the one program built up front, it stands in for the others until they are linked
+    m_shader = Shader::Find(dir + "/unlit");
+    cache.setFallback(m_shader);
+    // a cold start compiles everything once, later runs load the binaries;
+    // compiles run in the driver while the first frames render
+    cache.precompile(dir, true);
+    _shaders_pending = cache.stats().pending;
 }
 
 void test()
@@ -114,7 +319,7 @@ void MiniGL::dealMenu()
                 {
                     std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
                     std::string filePath = ImGuiFileDialog::Instance()->GetCurrentPath();
-                // action
+                    importFile(filePathName);
                 }
                 // close
                 ImGuiFileDialog::Instance()->Close();
@@ -122,30 +327,180 @@ void MiniGL::dealMenu()
         }
 }
 
+void MiniGL::importFile(const std::string& path)
+{
+    // reports what the import pipeline did; the meshes are not drawn yet, nothing keeps them
+    std::vector<CGE_UTIL::ImportedMesh> meshes;
+    std::string error;
+    if (!CGE_UTIL::importMeshes(path, meshes, error))
+    {
+        std::cout << "Import failed: " << error << std::endl;
+        return;
+    }
+    // imported meshes carry position, normal and uv, no color
+    const VertexFormat packed(VC_ALL, false, true);
+    for (const CGE_UTIL::ImportedMesh& mesh : meshes)
+    {
+        const size_t stride = CGE_UTIL::ImportedMesh::kStride;
+        size_t bytes = packed.stride();
+        if (mesh.vertexCount())
+        {
+            VertexStreams streams = {};
+            streams.position = { &mesh.vertices[0], stride };
+            streams.normal = { &mesh.vertices[3], stride };
+            streams.uv = { &mesh.vertices[6], stride };
+            streams.count = mesh.vertexCount();
+            bytes = packed.pack(streams).size() / streams.count;
+        }
+
+        const CGE_UTIL::MeshOptimizeStats& stats = mesh.stats;
+        printf("%s: vertices %zu -> %zu  acmr %.3f -> %.3f  atvr %.3f -> %.3f  bytes/vertex %zu -> %zu  lods %zu\n",
+            mesh.name.c_str(), stats.vertices_before, stats.vertices_after, stats.before.acmr, stats.after.acmr,
+            stats.before.atvr, stats.after.atvr, stride * sizeof(float), bytes, mesh.lods.size());
+    }
+}
+
+int MiniGL::stepSimulation(double elapsed)
+{
+    const double dt = 1.0 / _options.fixed_hz;
+    _accumulator += elapsed;
+
+    int steps = 0;
+    while (_accumulator >= dt && steps < _options.max_catchup_steps)
+    {
+        if (_fixed_update) _fixed_update(dt);
+        _sim_time += dt;
+        _accumulator -= dt;
+        steps++;
+    }
+    // out of catch-up budget: drop the backlog instead of spiralling
+    if (_accumulator >= dt)
+    {
+        long long dropped = (long long)(_accumulator / dt);
+        _dropped_steps += dropped;
+        _accumulator -= dropped * dt;
+    }
+    _alpha = _accumulator / dt;
+    _last_steps = steps;
+    return steps;
+}
+
+// ImGui::Image placeholder for the scene, the render thread swaps in the target's texture
+static const ImTextureID kSceneTexture = (ImTextureID)(intptr_t)-1;
+
 void MiniGL::renderCore()
 {
-    // core
+    // core, room for the scene image below the stats
+    ImGui::SetNextWindowSize(ImVec2(640, 520), ImGuiCond_FirstUseEver);
     ImGui::Begin("Core");
+    ImGui::Text("sim %.2f s  %.0f Hz  steps %d  alpha %.2f  dropped %lld", 
+        _sim_time, _options.fixed_hz, _last_steps, _alpha, _dropped_steps);
 
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    RenderQueueStats stats;
+    GLStateCounters gl_counters;
+    long long stream_used, stream_frame_size;
+    StreamBuffer::Mode stream_mode;
+    DebugDrawStats debug_stats;
+    size_t target_count, target_memory, target_allocations;
+    float resolution_scale;
+    double resolution_ms;
+    CaptureStats capture_stats;
+    {
+        std::lock_guard<std::mutex> lock(_stats_mutex);
+        stats = _queue_stats;
+        gl_counters = _gl_counters;
+        stream_used = _stream_used;
+        stream_frame_size = _stream_frame_size;
+        stream_mode = _stream_mode;
+        debug_stats = _debug_stats;
+        target_count = _target_count;
+        target_memory = _target_memory;
+        target_allocations = _target_allocations;
+        resolution_scale = _resolution_scale;
+        resolution_ms = _resolution_ms;
+        capture_stats = _capture_stats;
+    }
+    ImGui::Text("draws %d  batches %d  program binds %d  texture binds %d", 
+        stats.draws, stats.batches, stats.program_binds, stats.texture_binds);
+    ImGui::Text("record threads %u  render thread %s", _jobs.size(), _options.render_thread ? "on" : "off");
+    if (_culling.size())
+        ImGui::Text("visible %zu / %zu  (%s)", _visible.size(), _culling.size(), CullingSet::simdName());
+    if (_occlusion.occluderCount())
+    {
+        const OcclusionStats& occlusion = _occlusion.stats();
+        ImGui::Text("occluded %zu / %zu  occluder tris %zu  %.2f + %.2f ms", occlusion.culled, occlusion.tested,
+            occlusion.occluder_triangles, occlusion.render_ms, occlusion.test_ms);
+    }
+    ImGui::Text("gl state calls %llu  elided %llu", 
+        (unsigned long long)gl_counters.issued, (unsigned long long)gl_counters.elided);
+    static const char* stream_modes[] = { "none", "persistent", "unsynchronized", "orphan" };
+    ImGui::Text("stream %s  %.1f / %.1f KB", stream_modes[stream_mode], 
+        stream_used / 1024.0, stream_frame_size / 1024.0);
+    ImGui::Text("debug vertices %zu  draws %d", debug_stats.vertices, debug_stats.draws);
+    ImGui::Text("render targets %zu  %.1f MB  allocations %zu", target_count, target_memory / (1024.0 * 1024.0),
+        target_allocations);
+    ImGui::Checkbox("dynamic resolution", &_dynamic_resolution);
+    ImGui::SameLine();
+    ImGui::Text("scale %.2f  gpu %.2f ms", resolution_scale, resolution_ms);
+    if (capture_stats.written || capture_stats.pending || capture_stats.dropped)
+        ImGui::Text("capture %.3f ms  written %llu  pending %d  dropped %llu", capture_stats.cpu_ms,
+            (unsigned long long)capture_stats.written, capture_stats.pending, (unsigned long long)capture_stats.dropped);
 
-    // draw_list->AddCallback();
+    // the scene fills the rest of the window
+    ImVec2 scene_size = ImGui::GetContentRegionAvail();
+    ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+    _scene_w = std::max(0, (int)(scene_size.x * scale.x));
+    _scene_h = std::max(0, (int)(scene_size.y * scale.y));
+    if (_scene_w > 0 && _scene_h > 0)
+        ImGui::Image(kSceneTexture, scene_size, ImVec2(0, 1), ImVec2(1, 0));
 
+    ImVec2 core_pos = ImGui::GetWindowPos();
+    ImVec2 core_size = ImGui::GetWindowSize();
     ImGui::End();
+
+    if (_show_profiler)
+    {
+        ImGui::SetNextWindowPos(ImVec2(core_pos.x + core_size.x + 8, core_pos.y), ImGuiCond_FirstUseEver);
+        Profiler::Instance().drawWindow(&_show_profiler);
+    }
 }
 
-void MiniGL::mainLoop()
+void MiniGL::buildFrame(FramePacket& packet, double elapsed)
 {
-    ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
-    while (!glfwWindowShouldClose(_window))
+    Profiler& profiler = Profiler::Instance();
     {
+        CGE_PROFILE_SCOPE("PollEvents");
         glfwPollEvents();
+    }
+
+    // fixed rate update, rendering interpolates with renderAlpha()
+    {
+        CGE_PROFILE_SCOPE("Simulation");
+        stepSimulation(elapsed);
+    }
 
+    {
+        CGE_PROFILE_SCOPE("UI");
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        // F11 dumps the next frames as a Chrome trace
+        if (ImGui::IsKeyPressed(ImGuiKey_F11, false) && !profiler.capturingTrace())
+            profiler.captureTrace(_options.trace_file, _options.trace_frames > 0 ? _options.trace_frames : 120);
+        // F12 saves the next frame, Shift+F12 starts and stops a sequence
+        CaptureFormat capture_format = _options.capture_raw ? CAPTURE_RAW : CAPTURE_PNG;
+        if (ImGui::IsKeyPressed(ImGuiKey_F12, false))
+        {
+            if (!ImGui::GetIO().KeyShift)
+                _capture.screenshot(_options.capture_prefix, capture_format);
+            else if (_capture.sequenceActive())
+                _capture.stopSequence();
+            else
+                _capture.startSequence(_options.capture_prefix, 0, capture_format);
+        }
+
         // menu bar
         if (ImGui::BeginMainMenuBar()) 
         {
@@ -157,6 +512,11 @@ void MiniGL::mainLoop()
                 }
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("View")) 
+            {
+                ImGui::MenuItem("Profiler", nullptr, &_show_profiler);
+                ImGui::EndMenu();
+            }
             ImGui::EndMainMenuBar();
         }
         dealMenu();
@@ -165,13 +525,281 @@ void MiniGL::mainLoop()
         renderCore();
         
         ImGui::Render();
+    }
+
+    CGE_PROFILE_SCOPE("BuildPacket");
+    if (_offscreen_fbo)
+    {
+        _display_w = _options.width;
+        _display_h = _options.height;
+    }
+    else
         glfwGetFramebufferSize(_window, &_display_w, &_display_h);
-        glViewport(0, 0, _display_w, _display_h);
-        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        
+    packet.index = _frame_index;
+    packet.display_w = _display_w;
+    packet.display_h = _display_h;
+    packet.clear_color = _clear_color;
+    packet.scene_w = _scene_w;
+    packet.scene_h = _scene_h;
+    packet.dynamic_resolution = _dynamic_resolution;
+    packet.view = _render_view;
+    packet.ui.capture(ImGui::GetDrawData());
+
+    // culling, keys and uniform packing on the workers
+    packet.scene.clear();
+    size_t count = _scene_count;
+    if (_culling.size())
+    {
+        CGE_PROFILE_SCOPE("Culling");
+        count = _culling.cull(Frustum::fromView(_render_view.view, _render_view.projection), _visible, &_jobs);
+        if (_occlusion.occluderCount())
+        {
+            CGE_PROFILE_SCOPE("Occlusion");
+            _occlusion.render(_render_view.view, _render_view.projection, &_jobs);
+            count = _occlusion.filter(_culling, _visible, &_jobs);
+        }
+    }
+    if (_scene_recorder)
+        _recorder.record(_jobs, count, _scene_recorder, packet.scene);
+    _debug_draw.capture(packet.debug, elapsed);
+}
+
+static long long streamUpload(const void* data, long long size, long long alignment, void* user_data)
+{
+    return ((StreamBuffer*)user_data)->upload(data, (GLsizeiptr)size, (GLsizeiptr)alignment);
+}
+
+void MiniGL::renderFrame(FramePacket& packet)
+{
+    CGE_PROFILE_SCOPE("Render");
+    CGE_GPU_SCOPE("Frame");
+    {
+        CGE_PROFILE_SCOPE("ShaderPoll");
+        ShaderCache& shaders = ShaderCache::Instance();
+        // edits are picked up here and swapped in by a later poll, between frames
+        if (_shader_watcher.poll(&_shader_changes)) shaders.reload(_shader_changes);
+        int pending = shaders.poll();
+        if (_shaders_pending >= 0 && (_shaders_pending = pending) == 0)
+        {
+            ShaderCacheStats stats = shaders.stats();
+            printf("Shaders: %d programs, %d compiled, %d from binary cache, %d failed, %.1f ms, ready at frame %llu\n",
+                stats.programs, stats.compiled, stats.from_binary, stats.failed, stats.ms,
+                (unsigned long long)packet.index);
+            _shaders_pending = -1;
+        }
+    }
+    // ImGui rendered since the last frame
+    _gl_state.invalidate();
+    _gl_state.resetCounters();
+    _stream.beginFrame();
+    _gl_state.bindFramebuffer(_offscreen_fbo);
+    _gl_state.setViewport(0, 0, packet.display_w, packet.display_h);
+    const ImVec4& clear_color = packet.clear_color;
+    glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // the scene goes into a pooled target sized to the Core window
+    RenderTarget* scene_target = nullptr;
+    if (packet.scene_w > 0 && packet.scene_h > 0)
+        scene_target = _targets.acquire(RenderTargetDesc(packet.scene_w, packet.scene_h));
+    if (scene_target)
+    {
+        // below the frame budget the scene renders smaller and is upscaled, ImGui stays native
+        _resolution.setEnabled(packet.dynamic_resolution);
+        uint64_t gpu_frame;
+        double gpu_ms;
+        if (Profiler::Instance().latestGpuFrame(&gpu_frame, &gpu_ms))
+            _resolution.update(gpu_frame, gpu_ms);
+        int internal_w = _resolution.scaled(packet.scene_w), internal_h = _resolution.scaled(packet.scene_h);
+        RenderTarget* internal = scene_target;
+        if (internal_w != packet.scene_w || internal_h != packet.scene_h)
+            internal = _targets.acquire(RenderTargetDesc(internal_w, internal_h));
+        if (!internal || internal == scene_target)
+        {
+            internal = scene_target;
+            internal_w = packet.scene_w;
+            internal_h = packet.scene_h;
+        }
+
+        _gl_state.bindFramebuffer(internal->fbo);
+        _gl_state.setViewport(0, 0, internal_w, internal_h);
+        // debug draw depth tests against the scene
+        _gl_state.setDepth(true, true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderScene(packet);
+        if (internal != scene_target)
+        {
+            CGE_PROFILE_SCOPE("Upscale");
+            CGE_GPU_SCOPE("Upscale");
+            _gl_state.bindFramebuffer(scene_target->fbo);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, internal->fbo);
+            glBlitFramebuffer(0, 0, internal_w, internal_h, 0, 0, packet.scene_w, packet.scene_h,
+                GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_target->fbo);
+            _targets.release(internal);
+        }
+        _gl_state.bindFramebuffer(_offscreen_fbo);
+        _gl_state.setViewport(0, 0, packet.display_w, packet.display_h);
+        packet.ui.replaceTexture(kSceneTexture, (ImTextureID)(intptr_t)scene_target->color,
+            scene_target->u(packet.scene_w), scene_target->v(packet.scene_h));
+    }
+    else
+        packet.ui.replaceTexture(kSceneTexture, (ImTextureID)0);
+    {
+        CGE_PROFILE_SCOPE("ImGui");
+        CGE_GPU_SCOPE("ImGui");
+        // the backend binds buffers behind the cache's back
+        _gl_state.invalidate();
+        ImGui_ImplOpenGL3_SetStreamUpload(_stream.buffer(), streamUpload, &_stream);
+        ImGui_ImplOpenGL3_RenderDrawData(packet.ui.data());
+    }
+    {
+        CGE_PROFILE_SCOPE("Capture");
+        if (_options.capture_scene)
+            _capture.update(scene_target ? scene_target->fbo : 0, scene_target ? packet.scene_w : 0,
+                scene_target ? packet.scene_h : 0, packet.index);
+        else
+            _capture.update(_offscreen_fbo, packet.display_w, packet.display_h, packet.index);
+    }
+    if (scene_target) _targets.release(scene_target);
+    _targets.endFrame();
+    _stream.endFrame();
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _queue_stats = _render_queue.stats();
+    _gl_counters = _gl_state.counters();
+    _stream_used = (long long)_stream.used();
+    _stream_frame_size = (long long)_stream.frameSize();
+    _stream_mode = _stream.mode();
+    _debug_stats = _debug_renderer.stats();
+    _target_count = _targets.count();
+    _target_memory = _targets.memory();
+    _target_allocations = _targets.allocations();
+    _resolution_scale = _resolution.scale();
+    _resolution_ms = _resolution.smoothedMs();
+    _capture_stats = _capture.stats();
+}
+
+void MiniGL::renderScene(FramePacket& packet)
+{
+    {
+        CGE_PROFILE_SCOPE("Scene");
+        CGE_GPU_SCOPE("Scene");
+        _render_queue.swapContents(packet.scene.packets, packet.scene.uniforms);
+        _render_queue.sort();
+        _render_queue.flush(packet.view, _gl_state);
+        // give the storage back to the packet for the next recording
+        _render_queue.swapContents(packet.scene.packets, packet.scene.uniforms);
+        // hand back the defaults the ImGui backend expects
+        _gl_state.useProgram(0);
+        _gl_state.bindVertexArray(0);
+        _gl_state.bindTexture(0, GL_TEXTURE_2D, 0);
+    }
+    {
+        CGE_PROFILE_SCOPE("DebugDraw");
+        CGE_GPU_SCOPE("DebugDraw");
+        _debug_renderer.draw(packet.debug, packet.view, _stream, _gl_state);
+        _gl_state.useProgram(0);
+        _gl_state.bindVertexArray(0);
+    }
+}
+
+void MiniGL::present()
+{
+    CGE_PROFILE_SCOPE("Present");
+    if (_offscreen_fbo) 
+        glFinish();
+    else
         glfwSwapBuffers(_window);
+    GLRecorder::Instance().endFrame();
+}
+
+void MiniGL::renderLoop()
+{
+    Profiler& profiler = Profiler::Instance();
+    profiler.setThreadName("Render");
+    glfwMakeContextCurrent(_window);
+    while (FramePacket* packet = _pipeline.acquireRead())
+    {
+        profiler.beginFrame();
+        renderFrame(*packet);
+        // the packet is no longer needed, let the game thread fill it while we present
+        _pipeline.release();
+        present();
+        profiler.endFrame();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+void MiniGL::mainLoop()
+{
+    if (_window == nullptr) return;
+
+    int frame = 0;
+    double start_time = glfwGetTime(), worst_frame = 0.0;
+    double previous_time = start_time;
+    Profiler& profiler = Profiler::Instance();
+    profiler.setBudgetMs(1000.0 / 60.0);
+    profiler.setOutputs(_options.trace_file, _options.trace_frames > 0 ? _options.trace_frames : 120,
+        _options.profile_csv.empty() ? "profile.csv" : _options.profile_csv);
+    if (_options.trace_frames > 0)
+        profiler.captureTrace(_options.trace_file, _options.trace_frames);
+    if (_options.capture_frames > 0)
+        _capture.startSequence(_options.capture_prefix, _options.capture_frames,
+            _options.capture_raw ? CAPTURE_RAW : CAPTURE_PNG);
+
+    if (_options.render_thread)
+    {
+        // the render thread owns the context from here on, the game thread
+        // never touches GL: device objects must exist before it starts
+        ImGui_ImplOpenGL3_NewFrame();
+        glfwMakeContextCurrent(nullptr);
+        _pipeline.restart();
+        _render_thread = std::thread(&MiniGL::renderLoop, this);
+    }
+
+    while (!glfwWindowShouldClose(_window))
+    {
+        if (_options.frames > 0 && frame >= _options.frames) break;
+        double frame_start = glfwGetTime();
+        if (!_options.render_thread) profiler.beginFrame();
+
+        FramePacket* packet;
+        {
+            CGE_PROFILE_SCOPE("WaitPacket");
+            packet = &_pipeline.acquireWrite();
+        }
+        buildFrame(*packet, frame_start - previous_time);
+        previous_time = frame_start;
+        _pipeline.publish();
+        _frame_index++;
+
+        if (!_options.render_thread)
+        {
+            renderFrame(*_pipeline.acquireRead());
+            _pipeline.release();
+            present();
+            profiler.endFrame();
+        }
+        worst_frame = std::max(worst_frame, glfwGetTime() - frame_start);
+        frame++;
+    }
+
+    if (_render_thread.joinable())
+    {
+        _pipeline.stop();
+        _render_thread.join();
+        glfwMakeContextCurrent(_window);
     }
 
-}
\ No newline at end of file
+    profiler.finishTrace();
+    if (!_options.profile_csv.empty())
+        profiler.exportCsv(_options.profile_csv);
+
+    if (_options.frames > 0)
+    {
+        double total = glfwGetTime() - start_time;
+        printf("frames: %d  total: %.3f s  avg: %.3f ms  worst: %.3f ms  fps: %.1f\n", 
+            frame, total, 1000.0 * total / std::max(frame, 1), 1000.0 * worst_frame, frame / std::max(total, 1e-9));
+    }
+}
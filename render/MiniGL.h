@@ -3,32 +3,175 @@
 
 #define GL_SILENCE_DEPRECATION
 #include "render/Shader.h"
+#include "render/RenderQueue.h"
+#include "render/GLState.h"
+#include "render/CommandBuffer.h"
+#include "render/FramePacket.h"
+#include "render/StreamBuffer.h"
+#include "render/DebugDraw.h"
+#include "render/Culling.h"
+#include "render/OcclusionCulling.h"
+#include "render/RenderTarget.h"
+#include "render/DynamicResolution.h"
+#include "render/FrameCapture.h"
+#include "utils/FileWatcher.h"
+#include "utils/ThreadPool.h"
+#include <glad/gl.h>
 #include <GLFW/glfw3.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace CGE
 {
 
+struct MiniGLOptions
+{
+    bool headless;  // hidden window, render into an offscreen framebuffer
+    int frames;     // run this many frames then exit, 0 runs until the window closes
+    int width, height;
+    double fixed_hz;        // simulation update rate
+    int max_catchup_steps;  // fixed steps allowed per frame before dropping time
+    std::string profile_csv;    // per-frame profiler export written on exit
+    int trace_frames;           // frames per Chrome trace capture, started at launch when given on the command line
+    std::string trace_file;
+    unsigned threads;           // draw recording workers, 0 = one per hardware thread
+    bool render_thread;         // GL on its own thread, one frame behind the game thread
+    size_t cull_bench;          // run the culling benchmark over this many objects and exit
+    bool dynamic_resolution;    // scale the scene target to hold the frame budget on the GPU
+    float min_scale;            // lowest dynamic resolution scale
+    int capture_frames;         // frames captured from launch, F12 screenshots and Shift+F12 toggles a sequence at runtime
+    std::string capture_prefix;
+    bool capture_raw;           // RGBA8 files instead of PNG, cheap enough for continuous capture
+    bool capture_scene;         // capture the Core window's scene target instead of the whole window
+    int gl_capture_frames;      // record the GL command stream of this many frames from launch for GamEngReplay
+    std::string gl_capture_file;
+    std::string shader_cache;   // program-binary cache directory, empty compiles every run
+    bool shader_reload;         // recompile shaders when their source files change
+
+    MiniGLOptions(): headless(false), frames(0), width(1280), height(720),
+        fixed_hz(60.0), max_catchup_steps(5), trace_frames(0), trace_file("trace.json"), threads(0),
+        render_thread(true), cull_bench(0),
+        dynamic_resolution(true), min_scale(0.5f), capture_frames(0), capture_prefix("capture"),
+        capture_raw(false), capture_scene(false), gl_capture_frames(0), gl_capture_file("frames.glcap"),
+        shader_cache("shader_cache"), shader_reload(true) {}
+
+    // --headless, --frames N, --size WxH, --hz N, --max-steps N, --profile-csv FILE,
+    // --trace N, --trace-file FILE, --threads N, --single-thread, --cull-bench N,
+    // --fixed-res, --min-scale S, --capture N, --capture-prefix P, --capture-raw, --capture-scene,
+    // --gl-capture N, --gl-capture-file FILE, --shader-cache DIR, --no-shader-cache,
+    // --no-shader-reload
+    static MiniGLOptions parse(int argc, char** argv);
+};
+
 class MiniGL
 {
 public:
-    MiniGL();
+    MiniGL(const MiniGLOptions& options = MiniGLOptions());
+    ~MiniGL();
+    bool valid() const { return _window != nullptr; }
     void mainLoop();
     void dealMenu();
+    void importFile(const std::string& path);
     void renderCore();
 
+    // called at the fixed rate with the step length in seconds
+    void setFixedUpdate(std::function<void(double)> update) { _fixed_update = update; }
+    // fraction of a step left in the accumulator, blend previous and current state with it
+    double renderAlpha() const { return _alpha; }
+    // scene draws are recorded on the worker threads, fn gets chunks of [0, count).
+    // With objects in culling(), fn gets chunks of visibleObjects() instead.
+    void setSceneRecorder(size_t count, ParallelRecorder::RecordFn fn) { _scene_count = count; _scene_recorder = fn; }
+    // camera for the next frame, game thread
+    RenderView& renderView() { return _render_view; }
+    // world bounds of the scene objects, culled against renderView() every frame
+    CullingSet& culling() { return _culling; }
+    const std::vector<uint32_t>& visibleObjects() const { return _visible; }
+    // occluders hide culling() objects behind them, tested on the CPU after frustum culling
+    OcclusionBuffer& occlusion() { return _occlusion; }
+    // lines and triangles for the next frame, or longer with a duration
+    DebugDraw& debugDraw() { return _debug_draw; }
+
 private:
     void init();
     void initShaders();
+    void initOffscreen();
+    int stepSimulation(double elapsed);
+
+    // game thread: events, simulation, UI and draw recording into the packet
+    void buildFrame(FramePacket& packet, double elapsed);
+    // context thread: consumes an immutable packet
+    void renderFrame(FramePacket& packet);
+    // scene and debug draw into the bound target
+    void renderScene(FramePacket& packet);
+    void present();
+    void renderLoop();
 
     Shader m_shader;
     // Shader m_shaderFlat;
     // Shader m_shaderTex;
 
+    MiniGLOptions _options;
+    CGE_UTIL::ThreadPool _jobs;
     GLFWwindow* _window;
     int _display_w, _display_h;
     bool _open_dialog;
+    bool _show_profiler;
+
+    // game side scene recording
+    RenderView _render_view;
+    ParallelRecorder _recorder;
+    ParallelRecorder::RecordFn _scene_recorder;
+    size_t _scene_count;
+    CullingSet _culling;
+    std::vector<uint32_t> _visible;
+    OcclusionBuffer _occlusion;
+    uint64_t _frame_index;
+    ImVec4 _clear_color;
+    DebugDraw _debug_draw;
+    int _scene_w, _scene_h;     // Core window's scene image
+    bool _dynamic_resolution;
+
+    // render side, only touched by the thread owning the context
+    RenderQueue _render_queue;
+    GLStateCache _gl_state;
+    StreamBuffer _stream;
+    DebugDrawRenderer _debug_renderer;
+    RenderTargetPool _targets;
+    DynamicResolution _resolution;
+    FrameCapture _capture;
+    int _shaders_pending;       // -1 once startup compiles are done and reported
+    CGE_UTIL::FileWatcher _shader_watcher;
+    std::vector<std::string> _shader_changes;
+    FramePipeline _pipeline;
+    std::thread _render_thread;
+
+    // last frame's render stats for the UI
+    std::mutex _stats_mutex;
+    RenderQueueStats _queue_stats;
+    GLStateCounters _gl_counters;
+    long long _stream_used, _stream_frame_size;
+    StreamBuffer::Mode _stream_mode;
+    DebugDrawStats _debug_stats;
+    size_t _target_count, _target_memory, _target_allocations;
+    float _resolution_scale;
+    double _resolution_ms;
+    CaptureStats _capture_stats;
+
+    // fixed timestep simulation
+    std::function<void(double)> _fixed_update;
+    double _accumulator;
+    double _alpha;
+    double _sim_time;
+    int _last_steps;
+    long long _dropped_steps;
+
+    // headless render target
+    GLuint _offscreen_fbo;
+    GLuint _offscreen_color, _offscreen_depth;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGE_OCCLUSION_SSE
+#endif
+
+#include "render/OcclusionCulling.h"
+
+using namespace CGE;
+
+static const size_t kFilterChunk = 1024;
+
+// column major r = a * b
+static void multiply(const float* a, const float* b, float* r)
+{
+    for (int c = 0; c < 4; c++)
+        for (int row = 0; row < 4; row++)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[c * 4 + k];
+            r[c * 4 + row] = sum;
+        }
+}
+
+static inline void transformPoint(const float* m, float x, float y, float z, float* out)
+{
+    for (int row = 0; row < 4; row++)
+        out[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row];
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height):
+    _ready(false)
+{
+    _tiles_x = std::max(1, (width + kTileSize - 1) / kTileSize);
+    _tiles_y = std::max(1, (height + kTileSize - 1) / kTileSize);
+    _width = _tiles_x * kTileSize;
+    _height = _tiles_y * kTileSize;
+    _bins.resize(_tiles_x * _tiles_y);
+
+    int w = _width, h = _height;
+    while (true)
+    {
+        _levels.push_back(std::vector<float>(w * h, 1.0f));
+        _level_w.push_back(w);
+        _level_h.push_back(h);
+        if (w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+    memset(_view_projection, 0, sizeof(_view_projection));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t OcclusionBuffer::addOccluder(const float* positions, size_t vertex_count, const uint32_t* indices, size_t index_count,
+    const float* model)
+{
+    Occluder occluder;
+    memset(occluder.model, 0, sizeof(occluder.model));
+    occluder.positions.assign(positions, positions + vertex_count * 3);
+    occluder.indices.assign(indices, indices + index_count / 3 * 3);
+    _occluders.push_back(occluder);
+    uint32_t id = (uint32_t)_occluders.size() - 1;
+    setOccluderTransform(id, model);
+    return id;
+}
+
+void OcclusionBuffer::setOccluderTransform(uint32_t occluder, const float* model)
+{
+    static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    memcpy(_occluders[occluder].model, model ? model : identity, sizeof(identity));
+}
+
+void OcclusionBuffer::clearOccluders()
+{
+    _occluders.clear();
+    _ready = false;
+}
+
+void OcclusionBuffer::transform(const Occluder& occluder, std::vector<ScreenTriangle>& out) const
+{
+    out.clear();
+    float mvp[16];
+    multiply(_view_projection, occluder.model, mvp);
+
+    const float half_w = _width * 0.5f, half_h = _height * 0.5f;
+    auto project = [&](const float* clip, float* x, float* y, float* z)
+    {
+        float inv_w = 1.0f / clip[3];
+        *x = (clip[0] * inv_w + 1.0f) * half_w;
+        *y = (clip[1] * inv_w + 1.0f) * half_h;
+        *z = (clip[2] * inv_w) * 0.5f + 0.5f;
+    };
+    auto emit = [&](const float* a, const float* b, const float* c)
+    {
+        ScreenTriangle t;
+        project(a, &t.x[0], &t.y[0], &t.z[0]);
+        project(b, &t.x[1], &t.y[1], &t.z[1]);
+        project(c, &t.x[2], &t.y[2], &t.z[2]);
+        float minx = std::min(t.x[0], std::min(t.x[1], t.x[2])), maxx = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+        float miny = std::min(t.y[0], std::min(t.y[1], t.y[2])), maxy = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+        if (maxx < 0 || maxy < 0 || minx >= _width || miny >= _height) return;
+        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        if (std::fabs(area) < 1e-6f) return;
+        out.push_back(t);
+    };
+
+    std::vector<float> clip(occluder.positions.size() / 3 * 4);
+    for (size_t v = 0; v < clip.size() / 4; v++)
+        transformPoint(mvp, occluder.positions[v * 3], occluder.positions[v * 3 + 1], occluder.positions[v * 3 + 2], &clip[v * 4]);
+
+    for (size_t i = 0; i < occluder.indices.size(); i += 3)
+    {
+        const float* v[3] = { &clip[occluder.indices[i] * 4], &clip[occluder.indices[i + 1] * 4], &clip[occluder.indices[i + 2] * 4] };
+        // near plane z + w >= 0, clipping a triangle leaves at most a quad
+        float d[3];
+        int inside = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            d[k] = v[k][2] + v[k][3];
+            inside += d[k] >= 0;
+        }
+        if (inside == 3)
+        {
+            emit(v[0], v[1], v[2]);
+            continue;
+        }
+        if (inside == 0) continue;
+        float poly[4][4];
+        int n = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            int j = (k + 1) % 3;
+            if (d[k] >= 0) memcpy(poly[n++], v[k], sizeof(float) * 4);
+            if ((d[k] >= 0) != (d[j] >= 0))
+            {
+                float t = d[k] / (d[k] - d[j]);
+                for (int c = 0; c < 4; c++) poly[n][c] = v[k][c] + (v[j][c] - v[k][c]) * t;
+                n++;
+            }
+        }
+        emit(poly[0], poly[1], poly[2]);
+        if (n == 4) emit(poly[0], poly[2], poly[3]);
+    }
+}
+
+void OcclusionBuffer::rasterizeTile(int tile)
+{
+    const int tx0 = (tile % _tiles_x) * kTileSize, ty0 = (tile / _tiles_x) * kTileSize;
+    float* depth = _levels[0].data();
+    for (int y = ty0; y < ty0 + kTileSize; y++)
+        std::fill(depth + y * _width + tx0, depth + y * _width + tx0 + kTileSize, 1.0f);
+
+    for (uint32_t index : _bins[tile])
+    {
+        const ScreenTriangle& t = *_triangles[index];
+        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+        float sign = area > 0 ? 1.0f : -1.0f;
+        // E(x, y) = A x + B y + C, positive inside for either winding
+        float ea[3], eb[3], ec[3];
+        for (int k = 0; k < 3; k++)
+        {
+            int j = (k + 1) % 3;
+            ea[k] = (t.y[k] - t.y[j]) * sign;
+            eb[k] = (t.x[j] - t.x[k]) * sign;
+            ec[k] = -(ea[k] * t.x[k] + eb[k] * t.y[k]);
+        }
+        // depth is linear in screen space
+        float dzdx = ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+        float dzdy = ((t.z[2] - t.z[0]) * (t.x[1] - t.x[0]) - (t.z[1] - t.z[0]) * (t.x[2] - t.x[0])) / area;
+        float dz0 = t.z[0] - dzdx * t.x[0] - dzdy * t.y[0];
+
+        int x0 = std::max(tx0, (int)std::floor(std::min(t.x[0], std::min(t.x[1], t.x[2]))));
+        int x1 = std::min(tx0 + kTileSize - 1, (int)std::ceil(std::max(t.x[0], std::max(t.x[1], t.x[2]))));
+        int y0 = std::max(ty0, (int)std::floor(std::min(t.y[0], std::min(t.y[1], t.y[2]))));
+        int y1 = std::min(ty0 + kTileSize - 1, (int)std::ceil(std::max(t.y[0], std::max(t.y[1], t.y[2]))));
+        if (x0 > x1 || y0 > y1) continue;
+        x0 &= ~3;   // whole quads, tiles are multiples of 4 wide
+
+        for (int y = y0; y <= y1; y++)
+        {
+            const float py = y + 0.5f;
+            float* row = depth + y * _width;
+#ifdef CGE_OCCLUSION_SSE
+            const __m128 zero = _mm_setzero_ps();
+            __m128 row_e[3], step_a[3];
+            for (int k = 0; k < 3; k++)
+            {
+                row_e[k] = _mm_set1_ps(eb[k] * py + ec[k]);
+                step_a[k] = _mm_set1_ps(ea[k]);
+            }
+            const __m128 row_z = _mm_set1_ps(dzdy * py + dz0), step_z = _mm_set1_ps(dzdx);
+            for (int x = x0; x <= x1; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3, 2, 1, 0));
+                __m128 e0 = _mm_add_ps(row_e[0], _mm_mul_ps(step_a[0], px));
+                __m128 e1 = _mm_add_ps(row_e[1], _mm_mul_ps(step_a[1], px));
+                __m128 e2 = _mm_add_ps(row_e[2], _mm_mul_ps(step_a[2], px));
+                __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (!_mm_movemask_ps(covered)) continue;
+                __m128 z = _mm_add_ps(row_z, _mm_mul_ps(step_z, px));
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(covered, nearer), _mm_andnot_ps(covered, old)));
+            }
+#else
+            for (int x = x0; x <= x1; x++)
+            {
+                const float px = x + 0.5f;
+                if (ea[0] * px + eb[0] * py + ec[0] < 0 || ea[1] * px + eb[1] * py + ec[1] < 0 || ea[2] * px + eb[2] * py + ec[2] < 0)
+                    continue;
+                row[x] = std::min(row[x], dzdx * px + dzdy * py + dz0);
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionBuffer::reduceTile(int tile)
+{
+    // levels 1..log2(kTileSize) stay inside the tile
+    const int tx0 = (tile % _tiles_x) * kTileSize, ty0 = (tile / _tiles_x) * kTileSize;
+    for (int level = 1, size = kTileSize / 2; size >= 1; level++, size /= 2)
+    {
+        const std::vector<float>& src = _levels[level - 1];
+        std::vector<float>& dst = _levels[level];
+        const int sw = _level_w[level - 1], dw = _level_w[level];
+        const int x0 = tx0 >> level, y0 = ty0 >> level;
+        for (int y = y0; y < y0 + size; y++)
+            for (int x = x0; x < x0 + size; x++)
+            {
+                const float* a = &src[(2 * y) * sw + 2 * x];
+                const float* b = a + sw;
+                dst[y * dw + x] = std::max(std::max(a[0], a[1]), std::max(b[0], b[1]));
+            }
+    }
+}
+
+void OcclusionBuffer::render(const float* view, const float* projection, CGE_UTIL::ThreadPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    multiply(projection, view, _view_projection);
+
+    // transform and clip per occluder
+    _transformed.resize(_occluders.size());
+    auto transformRange = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++) transform(_occluders[i], _transformed[i]);
+    };
+    if (pool) pool->parallelFor(_occluders.size(), 1, transformRange);
+    else transformRange(0, _occluders.size());
+
+    // bin by tile
+    _triangles.clear();
+    for (std::vector<uint32_t>& bin : _bins) bin.clear();
+    for (const std::vector<ScreenTriangle>& list : _transformed)
+        for (const ScreenTriangle& t : list)
+        {
+            uint32_t index = (uint32_t)_triangles.size();
+            _triangles.push_back(&t);
+            float minx = std::min(t.x[0], std::min(t.x[1], t.x[2])), maxx = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+            float miny = std::min(t.y[0], std::min(t.y[1], t.y[2])), maxy = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+            int bx0 = std::max(0, (int)minx / kTileSize), bx1 = std::min(_tiles_x - 1, (int)maxx / kTileSize);
+            int by0 = std::max(0, (int)miny / kTileSize), by1 = std::min(_tiles_y - 1, (int)maxy / kTileSize);
+            for (int by = by0; by <= by1; by++)
+                for (int bx = bx0; bx <= bx1; bx++)
+                    _bins[by * _tiles_x + bx].push_back(index);
+        }
+
+    // tiles own disjoint pixels at every level up to the tile size
+    auto tiles = [&](size_t begin, size_t end)
+    {
+        for (size_t tile = begin; tile < end; tile++)
+        {
+            rasterizeTile((int)tile);
+            reduceTile((int)tile);
+        }
+    };
+    if (pool) pool->parallelFor(_bins.size(), 1, tiles);
+    else tiles(0, _bins.size());
+
+    // the top of the pyramid, odd sizes clamp to the last row and column
+    int first = 1;
+    while ((kTileSize >> first) > 1) first++;
+    for (size_t level = first + 1; level < _levels.size(); level++)
+    {
+        const std::vector<float>& src = _levels[level - 1];
+        const int sw = _level_w[level - 1], sh = _level_h[level - 1];
+        for (int y = 0; y < _level_h[level]; y++)
+            for (int x = 0; x < _level_w[level]; x++)
+            {
+                int sx0 = 2 * x, sx1 = std::min(2 * x + 1, sw - 1);
+                int sy0 = 2 * y, sy1 = std::min(2 * y + 1, sh - 1);
+                _levels[level][y * _level_w[level] + x] = std::max(
+                    std::max(src[sy0 * sw + sx0], src[sy0 * sw + sx1]),
+                    std::max(src[sy1 * sw + sx0], src[sy1 * sw + sx1]));
+            }
+    }
+
+    _ready = true;
+    _stats.occluder_triangles = _triangles.size();
+    _stats.render_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool OcclusionBuffer::visible(const float center[3], const float extents[3]) const
+{
+    if (!_ready) return true;
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX, minz = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        float clip[4];
+        transformPoint(_view_projection,
+            center[0] + ((corner & 1) ? extents[0] : -extents[0]),
+            center[1] + ((corner & 2) ? extents[1] : -extents[1]),
+            center[2] + ((corner & 4) ? extents[2] : -extents[2]), clip);
+        // crossing the near plane, the box covers the camera
+        if (clip[3] <= 1e-5f || clip[2] < -clip[3]) return true;
+        float inv_w = 1.0f / clip[3];
+        float x = (clip[0] * inv_w + 1.0f) * 0.5f * _width;
+        float y = (clip[1] * inv_w + 1.0f) * 0.5f * _height;
+        minx = std::min(minx, x);
+        maxx = std::max(maxx, x);
+        miny = std::min(miny, y);
+        maxy = std::max(maxy, y);
+        minz = std::min(minz, clip[2] * inv_w * 0.5f + 0.5f);
+    }
+    // off screen is for frustum culling to decide
+    if (maxx < 0 || maxy < 0 || minx >= _width || miny >= _height) return true;
+
+    int x0 = std::max(0, (int)minx), x1 = std::min(_width - 1, (int)maxx);
+    int y0 = std::max(0, (int)miny), y1 = std::min(_height - 1, (int)maxy);
+    // coarsest level still giving at most 4x4 texels
+    size_t level = 0;
+    while (level + 1 < _levels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+        level++;
+    const std::vector<float>& depth = _levels[level];
+    const int w = _level_w[level];
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+            if (depth[y * w + x] >= minz) return true;
+    return false;
+}
+
+size_t OcclusionBuffer::filter(const CullingSet& set, std::vector<uint32_t>& visible, CGE_UTIL::ThreadPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t tested = visible.size();
+    size_t chunks = (visible.size() + kFilterChunk - 1) / kFilterChunk;
+    if (_chunks.size() < chunks) _chunks.resize(chunks);
+    auto test = [&](size_t first, size_t last)
+    {
+        for (size_t c = first; c < last; c++)
+        {
+            _chunks[c].clear();
+            for (size_t i = c * kFilterChunk; i < std::min(visible.size(), (c + 1) * kFilterChunk); i++)
+            {
+                float center[3], extents[3];
+                set.bounds(visible[i], center, extents);
+                if (this->visible(center, extents)) _chunks[c].push_back(visible[i]);
+            }
+        }
+    };
+    if (pool) pool->parallelFor(chunks, 1, test);
+    else test(0, chunks);
+
+    visible.clear();
+    for (size_t c = 0; c < chunks; c++)
+        visible.insert(visible.end(), _chunks[c].begin(), _chunks[c].end());
+    _stats.tested = tested;
+    _stats.culled = tested - visible.size();
+    _stats.test_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return visible.size();
+}
@@ -0,0 +1,94 @@
+#ifndef _CGE_OCCLUSION_CULLING_H_
+#define _CGE_OCCLUSION_CULLING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "render/Culling.h"
+#include "utils/ThreadPool.h"
+
+namespace CGE
+{
+
+struct OcclusionStats
+{
+    size_t occluder_triangles;  // after near plane clipping
+    size_t tested;
+    size_t culled;
+    double render_ms;           // transform, binning, rasterization and hierarchical z
+    double test_ms;
+};
+
+// Software occlusion culling. Designated occluders (walls, floors, big props)
+// are drawn into a small depth buffer on the CPU: triangles are binned into
+// 32x32 tiles and each tile is rasterized by one job, 4 pixels at a time with
+// SSE. Every tile then reduces its depth into a max-depth pyramid, and object
+// bounds are tested against the pyramid level where they cover a few texels.
+// Nothing touches the GPU, so it works the same headless.
+class OcclusionBuffer
+{
+public:
+    static const int kTileSize = 32;
+
+    // rounded up to whole tiles
+    explicit OcclusionBuffer(int width = 256, int height = 128);
+
+    // occluder geometry is kept in object space and drawn every frame with its model matrix
+    uint32_t addOccluder(const float* positions, size_t vertex_count, const uint32_t* indices, size_t index_count,
+        const float* model = nullptr);
+    void setOccluderTransform(uint32_t occluder, const float* model);
+    void clearOccluders();
+    size_t occluderCount() const { return _occluders.size(); }
+
+    // rasterizes the occluders for this view and builds the depth pyramid
+    void render(const float* view, const float* projection, CGE_UTIL::ThreadPool* pool = nullptr);
+
+    // false when the box is certainly hidden behind occluders
+    bool visible(const float center[3], const float extents[3]) const;
+    // drops hidden objects from a frustum culled list, order is kept; returns the new size
+    size_t filter(const CullingSet& set, std::vector<uint32_t>& visible, CGE_UTIL::ThreadPool* pool = nullptr);
+
+    int width() const { return _width; }
+    int height() const { return _height; }
+    // 0 near, 1 far, rows bottom up
+    const std::vector<float>& depth() const { return _levels[0]; }
+    const OcclusionStats& stats() const { return _stats; }
+
+private:
+    struct Occluder
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        float model[16];
+    };
+    struct ScreenTriangle
+    {
+        float x[3], y[3], z[3];
+    };
+
+    void transform(const Occluder& occluder, std::vector<ScreenTriangle>& out) const;
+    void rasterizeTile(int tile);
+    void reduceTile(int tile);
+
+    int _width, _height;
+    int _tiles_x, _tiles_y;
+    float _view_projection[16];
+    bool _ready;
+
+    std::vector<Occluder> _occluders;
+    std::vector<std::vector<ScreenTriangle>> _transformed;  // per occluder
+    std::vector<const ScreenTriangle*> _triangles;
+    std::vector<std::vector<uint32_t>> _bins;               // triangles per tile
+
+    // level 0 is the depth buffer, each next level holds the max of 2x2 texels
+    std::vector<std::vector<float>> _levels;
+    std::vector<int> _level_w, _level_h;
+
+    std::vector<std::vector<uint32_t>> _chunks;
+    OcclusionStats _stats;
+};
+
+}
+
+#endif
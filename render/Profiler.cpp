@@ -0,0 +1,538 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "imgui.h"
+#include "render/Profiler.h"
+
+using namespace CGE;
+
+struct Profiler::ThreadLog
+{
+    uint32_t index;
+    std::string name;
+    std::mutex mutex;               // only contended while the frame is collected
+    std::vector<ProfileEvent> events;
+    std::vector<size_t> stack;      // open scopes, indices into events
+};
+
+static thread_local Profiler::ThreadLog* t_log = nullptr;
+
+static std::chrono::steady_clock::time_point epoch()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+double ProfileFrame::gpuMs() const
+{
+    uint64_t begin = UINT64_MAX, end = 0;
+    for (const ProfileEvent& e : gpu)
+    {
+        if (e.depth) continue;
+        begin = std::min(begin, e.start_ns);
+        end = std::max(end, e.end_ns);
+    }
+    return end > begin ? (end - begin) * 1e-6 : 0.0;
+}
+
+Profiler& Profiler::Instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler():
+    _enabled(true),
+    _paused(false),
+    _gpu_supported(false),
+    _budget_ms(1000.0 / 60.0),
+    _frame_index(0),
+    _frame_start(0),
+    _gpu_offset_ns(0),
+    _history(kHistory),
+    _selected_frame(0),
+    _trace_file("trace.json"),
+    _csv_file("profile.csv"),
+    _trace_frames(120),
+    _trace_first(0),
+    _trace_count(0)
+{
+    epoch();
+    for (GpuFrame& g : _gpu_frames)
+    {
+        g.index = 0;
+        g.used = 0;
+    }
+}
+
+Profiler::~Profiler()
+{
+    if (_trace_writer.joinable()) _trace_writer.join();
+}
+
+uint64_t Profiler::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count();
+}
+
+Profiler::ThreadLog& Profiler::threadLog()
+{
+    if (t_log) return *t_log;
+    std::lock_guard<std::mutex> lock(_mutex);
+    t_log = new ThreadLog();
+    t_log->index = (uint32_t)_threads.size();
+    t_log->name = t_log->index == 0 ? "Main" : "Thread " + std::to_string(t_log->index);
+    _threads.push_back(t_log);
+    return *t_log;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    ThreadLog& log = threadLog();
+    std::lock_guard<std::mutex> lock(_mutex);
+    log.name = name;
+}
+
+std::vector<std::string> Profiler::threadNames() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::string> names;
+    for (const ThreadLog* log : _threads) names.push_back(log->name);
+    return names;
+}
+
+void Profiler::beginScope(const char* name)
+{
+    if (!_enabled) return;
+    ThreadLog& log = threadLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    ProfileEvent e = { name, now(), 0, log.index, (uint32_t)log.stack.size() };
+    log.stack.push_back(log.events.size());
+    log.events.push_back(e);
+}
+
+void Profiler::endScope()
+{
+    ThreadLog& log = threadLog();
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.stack.empty()) return;
+    log.events[log.stack.back()].end_ns = now();
+    log.stack.pop_back();
+}
+
+GLuint Profiler::gpuQuery(GpuFrame& frame)
+{
+    if (frame.used == frame.pool.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.pool.push_back(query);
+    }
+    return frame.pool[frame.used++];
+}
+
+void Profiler::beginGpuScope(const char* name)
+{
+    if (!_enabled || !_gpu_supported) return;
+    GpuFrame& frame = _gpu_frames[_frame_index % kGpuLatency];
+    GpuQuery q = { name, (uint32_t)_gpu_stack.size(), gpuQuery(frame), 0 };
+    glQueryCounter(q.begin, GL_TIMESTAMP);
+    _gpu_stack.push_back(frame.scopes.size());
+    frame.scopes.push_back(q);
+}
+
+void Profiler::endGpuScope()
+{
+    if (!_gpu_supported || _gpu_stack.empty()) return;
+    GpuFrame& frame = _gpu_frames[_frame_index % kGpuLatency];
+    GpuQuery& q = frame.scopes[_gpu_stack.back()];
+    _gpu_stack.pop_back();
+    q.end = gpuQuery(frame);
+    glQueryCounter(q.end, GL_TIMESTAMP);
+}
+
+ProfileFrame* Profiler::findFrame(uint64_t index)
+{
+    if (index >= _frame_index || _frame_index - index > kHistory) return nullptr;
+    ProfileFrame& frame = _history[index % kHistory];
+    return frame.index == index ? &frame : nullptr;
+}
+
+void Profiler::resolveGpu(GpuFrame& g)
+{
+    if (g.scopes.empty() || g.used == 0) return;
+    // queries finish in submission order, the last one handed out (the outer
+    // scope's end, not the last scope opened) tells about all of them
+    GLuint available = 0;
+    glGetQueryObjectuiv(g.pool[g.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ProfileFrame* frame = findFrame(g.index);
+    if (!available || !frame) return;  // never stall, drop the results instead
+    frame->gpu.clear();
+    for (const GpuQuery& q : g.scopes)
+    {
+        if (!q.end) continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(q.begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(q.end, GL_QUERY_RESULT, &end);
+        ProfileEvent e = { q.name, (uint64_t)((int64_t)begin + _gpu_offset_ns),
+            (uint64_t)((int64_t)end + _gpu_offset_ns), 0, q.depth };
+        frame->gpu.push_back(e);
+    }
+    frame->gpu_resolved = true;
+}
+
+void Profiler::beginFrame()
+{
+    threadLog();
+    if (_frame_index == 0)
+        _gpu_supported = GLAD_GL_VERSION_3_3 != 0;
+
+    _frame_start = now();
+    if (_gpu_supported && _enabled)
+    {
+        if (_frame_index % 64 == 0)
+        {
+            // map GPU timestamps onto the CPU timeline
+            GLint64 gpu_now = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+            _gpu_offset_ns = (int64_t)now() - gpu_now;
+        }
+        GpuFrame& g = _gpu_frames[_frame_index % kGpuLatency];
+        resolveGpu(g);
+        g.index = _frame_index;
+        g.scopes.clear();
+        g.used = 0;
+        _gpu_stack.clear();
+    }
+}
+
+void Profiler::endFrame()
+{
+    uint64_t frame_end = now();
+    std::lock_guard<std::mutex> lock(_mutex);
+    ProfileFrame& frame = _history[_frame_index % kHistory];
+    frame.index = _frame_index;
+    frame.start_ns = _frame_start;
+    frame.end_ns = frame_end;
+    frame.cpu.clear();
+    frame.gpu.clear();
+    frame.gpu_resolved = false;
+    for (ThreadLog* log : _threads)
+    {
+        std::lock_guard<std::mutex> thread_lock(log->mutex);
+        // scopes still open carry over to the next frame
+        std::vector<ProfileEvent> open;
+        for (size_t i : log->stack) open.push_back(log->events[i]);
+        for (const ProfileEvent& e : log->events)
+            if (e.end_ns) frame.cpu.push_back(e);
+        log->events.swap(open);
+        for (size_t i = 0; i < log->stack.size(); i++) log->stack[i] = i;
+    }
+    _frame_index++;
+
+    // GPU results of the last captured frame are in after kGpuLatency more frames
+    if (_trace_count && _frame_index >= _trace_first + _trace_count + kGpuLatency)
+        flushTrace(_trace_first + _trace_count);
+}
+
+void Profiler::setOutputs(const std::string& trace_path, int trace_frames, const std::string& csv_path)
+{
+    _trace_file = trace_path;
+    _trace_frames = std::max(1, trace_frames);
+    _csv_file = csv_path;
+}
+
+void Profiler::captureTrace(const std::string& path, int frames)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // the render thread ends a capture in flushTrace, check under the same lock
+    if (_trace_count) return;
+    _trace_path = path;
+    _trace_first = _frame_index;
+    _trace_count = std::max(1, std::min(frames, kHistory - kGpuLatency));
+    std::cout << "Capturing " << _trace_count << " frames to " << path << std::endl;
+}
+
+bool Profiler::capturingTrace() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _trace_count > 0;
+}
+
+void Profiler::flushTrace(uint64_t end)
+{
+    // called with _mutex held
+    std::vector<ProfileFrame> captured;
+    for (uint64_t i = _trace_first; i < end; i++)
+        if (ProfileFrame* frame = findFrame(i)) captured.push_back(*frame);
+    std::vector<std::string> names;
+    for (const ThreadLog* log : _threads) names.push_back(log->name);
+    std::string path = _trace_path;
+    _trace_count = 0;
+
+    if (_trace_writer.joinable()) _trace_writer.join();
+    _trace_writer = std::thread([path, captured, names]() {
+        if (writeChromeTrace(path, captured, names))
+            std::cout << "Wrote " << captured.size() << " frames to " << path << std::endl;
+        else
+            std::cout << "Failed to write trace " << path << std::endl;
+    });
+}
+
+void Profiler::finishTrace()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_trace_count) flushTrace(std::min<uint64_t>(_frame_index, _trace_first + _trace_count));
+    }
+    if (_trace_writer.joinable()) _trace_writer.join();
+}
+
+static void writeJsonString(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+bool Profiler::writeChromeTrace(const std::string& path, const std::vector<ProfileFrame>& frames,
+    const std::vector<std::string>& threads)
+{
+    std::ofstream out(path);
+    if (!out) return false;
+
+    // lanes: profiler threads keep their index, frames and GPU get their own
+    const uint32_t frame_tid = 1000, gpu_tid = 1001;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"GamEng\"}}";
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        writeJsonString(out, threads[t]);
+        out << "}}";
+    }
+    out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << frame_tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\"Frames\"}}";
+    out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << gpu_tid << ",\"name\":\"thread_name\",\"args\":{\"name\":\"GPU\"}}";
+
+    char line[128];
+    for (const ProfileFrame& f : frames)
+    {
+        snprintf(line, sizeof(line), "\"ts\":%.3f,\"dur\":%.3f", f.start_ns * 1e-3, (f.end_ns - f.start_ns) * 1e-3);
+        out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << frame_tid << ",\"name\":\"Frame " << f.index << "\"," << line << "}";
+        for (int gpu = 0; gpu < 2; gpu++)
+            for (const ProfileEvent& e : gpu ? f.gpu : f.cpu)
+            {
+                snprintf(line, sizeof(line), "\"ts\":%.3f,\"dur\":%.3f", e.start_ns * 1e-3, (e.end_ns - e.start_ns) * 1e-3);
+                out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << (gpu ? gpu_tid : e.thread) << ",\"name\":";
+                writeJsonString(out, e.name);
+                out << "," << line << ",\"args\":{\"frame\":" << f.index << "}}";
+            }
+    }
+    out << "\n]}\n";
+    return (bool)out;
+}
+
+bool Profiler::latestGpuFrame(uint64_t* index, double* ms) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint64_t count = std::min<uint64_t>(_frame_index, kHistory);
+    for (uint64_t i = _frame_index; i > _frame_index - count; i--)
+    {
+        const ProfileFrame& frame = _history[(i - 1) % kHistory];
+        if (!frame.gpu_resolved || frame.gpu.empty()) continue;
+        *index = frame.index;
+        *ms = frame.gpuMs();
+        return true;
+    }
+    return false;
+}
+
+std::vector<ProfileFrame> Profiler::frames() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<ProfileFrame> result;
+    uint64_t count = std::min<uint64_t>(_frame_index, kHistory);
+    for (uint64_t i = _frame_index - count; i < _frame_index; i++)
+        result.push_back(_history[i % kHistory]);
+    return result;
+}
+
+bool Profiler::exportCsv(const std::string& path, int count) const
+{
+    std::ofstream out(path);
+    if (!out) return false;
+    std::vector<ProfileFrame> history = frames();
+    size_t first = history.size() > (size_t)count ? history.size() - count : 0;
+
+    out << "frame,thread,depth,name,start_ms,duration_ms,gpu\n";
+    for (size_t i = first; i < history.size(); i++)
+    {
+        const ProfileFrame* f = &history[i];
+        char line[256];
+        snprintf(line, sizeof(line), "%llu,-1,-1,Frame,0.000,%.3f,0\n", (unsigned long long)f->index, f->cpuMs());
+        out << line;
+        for (int gpu = 0; gpu < 2; gpu++)
+            for (const ProfileEvent& e : gpu ? f->gpu : f->cpu)
+            {
+                snprintf(line, sizeof(line), "%llu,%u,%u,%s,%.3f,%.3f,%d\n", (unsigned long long)f->index, e.thread, e.depth, e.name,
+                    ((int64_t)e.start_ns - (int64_t)f->start_ns) * 1e-6, (e.end_ns - e.start_ns) * 1e-6, gpu);
+                out << line;
+            }
+    }
+    return true;
+}
+
+static void drawRow(ImDrawList* draw_list, const std::vector<ProfileEvent>& events, uint32_t thread, bool gpu,
+    uint64_t start_ns, double ns_to_px, ImVec2 origin, float row_h, const ProfileEvent** hovered)
+{
+    ImVec2 mouse = ImGui::GetIO().MousePos;
+    for (const ProfileEvent& e : events)
+    {
+        if (!gpu && e.thread != thread) continue;
+        float x0 = origin.x + (float)(((int64_t)e.start_ns - (int64_t)start_ns) * ns_to_px);
+        float x1 = origin.x + (float)(((int64_t)e.end_ns - (int64_t)start_ns) * ns_to_px);
+        x1 = std::max(x1, x0 + 1.0f);
+        float y0 = origin.y + e.depth * row_h;
+        // stable colour per scope name
+        ImU32 hash = 2166136261u;
+        for (const char* c = e.name; *c; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+        ImU32 col = IM_COL32(90 + (hash & 0x7f), 90 + ((hash >> 8) & 0x7f), 90 + ((hash >> 16) & 0x7f), 255);
+        draw_list->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y0 + row_h - 1), col);
+        if (x1 - x0 > 20)
+        {
+            draw_list->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y0 + row_h), true);
+            draw_list->AddText(ImVec2(x0 + 2, y0 + 1), IM_COL32_BLACK, e.name);
+            draw_list->PopClipRect();
+        }
+        if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y0 + row_h)
+            *hovered = &e;
+    }
+}
+
+void Profiler::drawWindow(bool* open)
+{
+    ImGui::SetNextWindowSize(ImVec2(520, 420), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", open))
+    {
+        ImGui::End();
+        return;
+    }
+
+    if (!_paused) _frozen.clear();
+    else if (_frozen.empty()) _frozen = frames();
+    std::vector<ProfileFrame> live;
+    if (!_paused) live = frames();
+    const std::vector<ProfileFrame>& history = _paused ? _frozen : live;
+    if (history.empty())
+    {
+        ImGui::End();
+        return;
+    }
+
+    // frame time graph
+    float times[kHistory];
+    int over_budget = 0;
+    for (size_t i = 0; i < history.size(); i++)
+    {
+        times[i] = (float)history[i].cpuMs();
+        over_budget += times[i] > _budget_ms;
+    }
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%.2f ms cpu  %.2f ms gpu", times[history.size() - 1], history.back().gpuMs());
+    ImGui::PlotHistogram("##frames", times, (int)history.size(), 0, overlay, 0.0f, (float)_budget_ms * 2.0f,
+        ImVec2(ImGui::GetContentRegionAvail().x, 60));
+    ImGui::Text("%d of the last %d frames over the %.1f ms budget", over_budget, (int)history.size(), _budget_ms);
+
+    ImGui::Checkbox("Pause", &_paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) exportCsv(_csv_file);
+    ImGui::SameLine();
+    if (capturingTrace()) ImGui::TextUnformatted("Capturing...");
+    else if (ImGui::Button("Capture trace")) captureTrace(_trace_file, _trace_frames);
+    if (!_paused) _selected_frame = 0;
+    int back = (int)_selected_frame;
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(-1);
+    ImGui::SliderInt("##frame", &back, 0, (int)history.size() - 1, "%d frames back");
+    _selected_frame = back;
+
+    // the newest frame usually has no GPU data yet, prefer the latest resolved one
+    int selected = (int)history.size() - 1 - back;
+    if (!_paused && back == 0)
+        for (int i = selected; i >= 0 && i > selected - kGpuLatency - 1; i--)
+            if (history[i].gpu_resolved || !_gpu_supported) { selected = i; break; }
+    const ProfileFrame& frame = history[selected];
+
+    // timeline, one lane per thread plus the GPU lane
+    std::vector<std::string> names = threadNames();
+    const float row_h = ImGui::GetTextLineHeight() + 2;
+    const float label_w = 80;
+    float width = std::max(ImGui::GetContentRegionAvail().x - label_w, 50.0f);
+    uint64_t span = std::max<uint64_t>(frame.end_ns - frame.start_ns, 1);
+    for (const ProfileEvent& e : frame.gpu)
+        span = std::max<uint64_t>(span, e.end_ns > frame.start_ns ? e.end_ns - frame.start_ns : 0);
+    double ns_to_px = width / (double)span;
+
+    ImGui::Text("Frame %llu  %.3f ms", (unsigned long long)frame.index, frame.cpuMs());
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const ProfileEvent* hovered = nullptr;
+    for (size_t t = 0; t <= names.size(); t++)
+    {
+        bool gpu = t == names.size();
+        uint32_t depth = 0;
+        bool any = false;
+        for (const ProfileEvent& e : gpu ? frame.gpu : frame.cpu)
+            if (gpu || e.thread == t) { depth = std::max(depth, e.depth); any = true; }
+        if (!any && t != 0) continue;
+
+        ImVec2 p = ImGui::GetCursorScreenPos();
+        ImGui::TextUnformatted(gpu ? "GPU" : names[t].c_str());
+        drawRow(draw_list, gpu ? frame.gpu : frame.cpu, (uint32_t)t, gpu, frame.start_ns, ns_to_px,
+            ImVec2(p.x + label_w, p.y), row_h, &hovered);
+        ImGui::SetCursorScreenPos(p);
+        ImGui::Dummy(ImVec2(label_w + width, (depth + 1) * row_h));
+    }
+    if (hovered)
+        ImGui::SetTooltip("%s\n%.3f ms", hovered->name, (hovered->end_ns - hovered->start_ns) * 1e-6);
+
+    // per-scope totals
+    struct Total { int calls; double cpu; double gpu; };
+    std::map<std::string, Total> totals;
+    for (const ProfileEvent& e : frame.cpu)
+    {
+        Total& t = totals[e.name];
+        t.calls++;
+        t.cpu += (e.end_ns - e.start_ns) * 1e-6;
+    }
+    for (const ProfileEvent& e : frame.gpu)
+        totals[e.name].gpu += (e.end_ns - e.start_ns) * 1e-6;
+    if (ImGui::BeginTable("scopes", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY))
+    {
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("CPU ms");
+        ImGui::TableSetupColumn("GPU ms");
+        ImGui::TableHeadersRow();
+        for (const auto& it : totals)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(it.first.c_str());
+            ImGui::TableNextColumn(); ImGui::Text("%d", it.second.calls);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", it.second.cpu);
+            ImGui::TableNextColumn(); ImGui::Text("%.3f", it.second.gpu);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,158 @@
+#ifndef _CGE_PROFILER_H_
+#define _CGE_PROFILER_H_
+
+#include <glad/gl.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CGE
+{
+
+struct ProfileEvent
+{
+    const char* name;   // must outlive the profiler, use string literals
+    uint64_t start_ns;  // relative to the profiler epoch
+    uint64_t end_ns;
+    uint32_t thread;    // profiler thread index, 0 is the context thread
+    uint32_t depth;
+};
+
+struct ProfileFrame
+{
+    uint64_t index;
+    uint64_t start_ns, end_ns;
+    std::vector<ProfileEvent> cpu;
+    std::vector<ProfileEvent> gpu;  // filled a few frames late, when the queries resolve
+    bool gpu_resolved;
+
+    ProfileFrame(): index(0), start_ns(0), end_ns(0), gpu_resolved(false) {}
+    double cpuMs() const { return (end_ns - start_ns) * 1e-6; }
+    double gpuMs() const;
+};
+
+// Hierarchical frame profiler. CPU scopes nest per thread and can be opened from
+// any thread; GPU scopes use GL timestamp queries kept in a ring of frames so
+// results are only read once they are available.
+class Profiler
+{
+public:
+    static const int kHistory = 256;
+    static const int kGpuLatency = 4;
+
+    struct ThreadLog;
+
+    static Profiler& Instance();
+
+    // context thread, around everything else in the frame
+    void beginFrame();
+    void endFrame();
+
+    void beginScope(const char* name);
+    void endScope();
+    // context thread only, no-op without timer query support
+    void beginGpuScope(const char* name);
+    void endGpuScope();
+
+    void setThreadName(const char* name);
+    uint64_t now() const;
+
+    bool enabled() const { return _enabled; }
+    void setEnabled(bool enabled) { _enabled = enabled; }
+    void setBudgetMs(double budget) { _budget_ms = budget; }
+    // where the window's Capture trace and Export CSV buttons write, set before the first frame
+    void setOutputs(const std::string& trace_path, int trace_frames, const std::string& csv_path);
+
+    // copies of the frames still in the history, oldest first
+    std::vector<ProfileFrame> frames() const;
+    // GPU time of the newest frame whose queries have resolved, false before the first one
+    bool latestGpuFrame(uint64_t* index, double* ms) const;
+    std::vector<std::string> threadNames() const;
+    // offset of the GPU clock from the CPU epoch, in ns
+    int64_t gpuClockOffset() const { return _gpu_offset_ns; }
+
+    void drawWindow(bool* open = nullptr);
+    // one row per scope of the last frames: frame,thread,depth,name,start_ms,duration_ms,gpu
+    bool exportCsv(const std::string& path, int frames = kHistory) const;
+
+    // Chrome trace (chrome://tracing, Perfetto) of the next frames, written from a
+    // background thread once their GPU queries have resolved
+    void captureTrace(const std::string& path, int frames);
+    bool capturingTrace() const;
+    // write a pending capture with whatever has been recorded and wait for the writer
+    void finishTrace();
+    static bool writeChromeTrace(const std::string& path, const std::vector<ProfileFrame>& frames,
+        const std::vector<std::string>& threads);
+
+private:
+    struct GpuQuery
+    {
+        const char* name;
+        uint32_t depth;
+        GLuint begin, end;
+    };
+    struct GpuFrame
+    {
+        uint64_t index;
+        std::vector<GpuQuery> scopes;
+        std::vector<GLuint> pool;
+        size_t used;
+    };
+
+    Profiler();
+    ~Profiler();
+    ThreadLog& threadLog();
+    GLuint gpuQuery(GpuFrame& frame);
+    void resolveGpu(GpuFrame& frame);
+    ProfileFrame* findFrame(uint64_t index);
+    void flushTrace(uint64_t end);
+
+    bool _enabled;
+    bool _paused;
+    std::atomic<bool> _gpu_supported;  // set by the render thread, read by drawWindow()
+    double _budget_ms;
+    uint64_t _frame_index;
+    uint64_t _frame_start;
+    int64_t _gpu_offset_ns;
+
+    mutable std::mutex _mutex;  // thread registry and history
+    std::vector<ThreadLog*> _threads;
+    std::vector<ProfileFrame> _history;
+    GpuFrame _gpu_frames[kGpuLatency];
+    std::vector<size_t> _gpu_stack;
+    std::vector<ProfileFrame> _frozen;  // history snapshot while the window is paused
+    uint64_t _selected_frame;
+
+    std::string _trace_file, _csv_file;  // window buttons
+    int _trace_frames;
+    std::string _trace_path;  // capture in progress
+    uint64_t _trace_first;
+    int _trace_count;
+    std::thread _trace_writer;
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name) { Profiler::Instance().beginScope(name); }
+    ~ProfileScope() { Profiler::Instance().endScope(); }
+};
+
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(const char* name) { Profiler::Instance().beginGpuScope(name); }
+    ~GpuProfileScope() { Profiler::Instance().endGpuScope(); }
+};
+
+}
+
+#define CGE_PROFILE_CONCAT2(a, b) a##b
+#define CGE_PROFILE_CONCAT(a, b) CGE_PROFILE_CONCAT2(a, b)
+#define CGE_PROFILE_SCOPE(name) CGE::ProfileScope CGE_PROFILE_CONCAT(_cge_scope_, __LINE__)(name)
+#define CGE_GPU_SCOPE(name) CGE::GpuProfileScope CGE_PROFILE_CONCAT(_cge_gpu_scope_, __LINE__)(name)
+
+#endif
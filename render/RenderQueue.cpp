@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstring>
+
+#include "render/RenderQueue.h"
+#include "render/GLState.h"
+#include "render/Profiler.h"
+#include "render/Shader.h"
+
+using namespace CGE;
+
+uint64_t SortKey::make(RenderPass pass, uint32_t program, uint32_t material, float depth)
+{
+    uint64_t d = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 0xffffff);
+    uint64_t p = program & 0xfff;
+    uint64_t m = material & 0xffff;
+    if (pass == PASS_TRANSPARENT)
+        return ((uint64_t)pass << 60) | ((0xffffff - d) << 36) | (p << 24) | (m << 8);
+    return ((uint64_t)pass << 60) | (p << 48) | (m << 32) | (d << 8);
+}
+
+RenderView::RenderView()
+{
+    for (int i = 0; i < 16; i++)
+        view[i] = projection[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    view_pos[0] = view_pos[1] = view_pos[2] = 0.0f;
+    for (int i = 0; i < kUniformBlocks; i++) uniform_buffers[i] = 0;
+}
+
+// in UniformBlock order
+static const char* s_block_names[RenderView::kUniformBlocks] =
+    { "AmbientBlock", "DirectionalLightBlock", "PointLightBlock", "MaterialBlock", "ShadowBlock" };
+
+// fixed-function state per RenderPass; nothing culls, imported meshes come with either winding
+struct PassState { bool blend, depth_test, depth_write; };
+static const PassState s_pass_states[] =
+{
+    { false, true, true },      // PASS_SHADOW
+    { false, true, true },      // PASS_OPAQUE
+    { true, true, false },      // PASS_TRANSPARENT, tested against the opaque depth but not written
+    { true, false, false },     // PASS_OVERLAY
+};
+
+RenderQueue::RenderQueue():
+    _shader_generation(0),
+    _sorted(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void RenderQueue::clear()
+{
+    _packets.clear();
+    _uniform_data.clear();
+    _sorted = false;
+}
+
+uint32_t RenderQueue::pushMatrix(const float* m)
+{
+    uint32_t offset = (uint32_t)_uniform_data.size();
+    _uniform_data.insert(_uniform_data.end(), m, m + 16);
+    return offset;
+}
+
+void RenderQueue::append(const std::vector<DrawPacket>& packets, const std::vector<float>& uniforms)
+{
+    uint32_t base = (uint32_t)_uniform_data.size();
+    _uniform_data.insert(_uniform_data.end(), uniforms.begin(), uniforms.end());
+    size_t first = _packets.size();
+    _packets.insert(_packets.end(), packets.begin(), packets.end());
+    for (size_t i = first; i < _packets.size(); i++) _packets[i].model += base;
+    _sorted = false;
+}
+
+void RenderQueue::swapContents(std::vector<DrawPacket>& packets, std::vector<float>& uniforms)
+{
+    _packets.swap(packets);
+    _uniform_data.swap(uniforms);
+    _sorted = false;
+}
+
+void RenderQueue::radixSort(const std::vector<DrawPacket>& packets, std::vector<uint32_t>& order,
+    std::vector<uint64_t>& scratch_keys, std::vector<uint32_t>& scratch_order)
+{
+    const size_t n = packets.size();
+    order.resize(n);
+    scratch_keys.resize(2 * n);
+    scratch_order.resize(n);
+    uint64_t* keys = scratch_keys.data();
+    uint64_t* keys_tmp = keys + n;
+    uint32_t* idx = order.data();
+    uint32_t* idx_tmp = scratch_order.data();
+
+    // one pass over the keys builds all eight byte histograms
+    uint32_t histogram[8][256];
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < n; i++)
+    {
+        uint64_t key = packets[i].key;
+        keys[i] = key;
+        idx[i] = (uint32_t)i;
+        for (int b = 0; b < 8; b++) histogram[b][(key >> (b * 8)) & 0xff]++;
+    }
+
+    for (int b = 0; b < 8; b++)
+    {
+        uint32_t* h = histogram[b];
+        // every key has the same byte here, nothing to reorder
+        if (h[(keys[0] >> (b * 8)) & 0xff] == n) continue;
+
+        uint32_t sum = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            uint32_t count = h[i];
+            h[i] = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t dst = h[(keys[i] >> (b * 8)) & 0xff]++;
+            keys_tmp[dst] = keys[i];
+            idx_tmp[dst] = idx[i];
+        }
+        std::swap(keys, keys_tmp);
+        std::swap(idx, idx_tmp);
+    }
+    if (idx != order.data())
+        memcpy(order.data(), idx, n * sizeof(uint32_t));
+}
+
+void RenderQueue::sort()
+{
+    CGE_PROFILE_SCOPE("RenderQueue::sort");
+    _sorted = true;
+    if (_packets.empty())
+    {
+        _order.clear();
+        return;
+    }
+    radixSort(_packets, _order, _scratch_keys, _scratch_order);
+}
+
+const RenderQueue::ProgramUniforms& RenderQueue::uniforms(GLuint program, GLStateCache& state)
+{
+    for (const ProgramUniforms& u : _programs)
+        if (u.program == program) return u;
+    ProgramUniforms u;
+    u.program = program;
+    u.model = glGetUniformLocation(program, "u_model");
+    u.view = glGetUniformLocation(program, "u_view");
+    u.projection = glGetUniformLocation(program, "u_projection");
+    u.view_pos = glGetUniformLocation(program, "u_view_pos");
+    u.diffuse = glGetUniformLocation(program, "u_diffuse_texture");
+    u.specular = glGetUniformLocation(program, "u_specular_texture");
+
+    // sampler units and block bindings are program state, set them once
+    state.useProgram(program);
+    if (u.diffuse >= 0) glUniform1i(u.diffuse, 0);
+    if (u.specular >= 0) glUniform1i(u.specular, 1);
+    for (GLuint i = 0; i < RenderView::kUniformBlocks; i++)
+    {
+        GLuint block = glGetUniformBlockIndex(program, s_block_names[i]);
+        if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, i);
+    }
+    _programs.push_back(u);
+    return _programs.back();
+}
+
+void RenderQueue::flush(const RenderView& view, GLStateCache& state)
+{
+    CGE_PROFILE_SCOPE("RenderQueue::flush");
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.packets = (int)_packets.size();
+    if (_packets.empty()) return;
+    if (!_sorted) sort();
+
+    // a deleted program's name can come back for a different program
+    uint32_t generation = ShaderCache::Instance().generation();
+    if (generation != _shader_generation)
+    {
+        _programs.clear();
+        _shader_generation = generation;
+    }
+
+    for (GLuint i = 0; i < RenderView::kUniformBlocks; i++)
+        if (view.uniform_buffers[i]) state.bindUniformBuffer(i, view.uniform_buffers[i]);
+
+    GLuint program = 0, vao = 0;
+    GLuint textures[2] = { 0, 0 };
+    const ProgramUniforms* u = nullptr;
+    bool batch_open = false;
+    int pass = -1;
+    for (uint32_t i : _order)
+    {
+        const DrawPacket& p = _packets[i];
+        bool batch_break = !batch_open;
+        // keys sort by pass first, so this changes at most once per pass
+        if ((int)SortKey::pass(p.key) != pass)
+        {
+            pass = (int)SortKey::pass(p.key);
+            const PassState& ps = s_pass_states[std::min(pass, (int)PASS_OVERLAY)];
+            state.setBlend(ps.blend);
+            state.setDepth(ps.depth_test, ps.depth_write);
+            state.setCull(false);
+            batch_break = true;
+        }
+        if (p.program != program)
+        {
+            program = p.program;
+            u = &uniforms(program, state);
+            state.useProgram(program);
+            if (u->view >= 0) glUniformMatrix4fv(u->view, 1, GL_FALSE, view.view);
+            if (u->projection >= 0) glUniformMatrix4fv(u->projection, 1, GL_FALSE, view.projection);
+            if (u->view_pos >= 0) glUniform3fv(u->view_pos, 1, view.view_pos);
+            _stats.program_binds++;
+            batch_break = true;
+        }
+        if (p.vao != vao)
+        {
+            vao = p.vao;
+            state.bindVertexArray(vao);
+            _stats.vao_binds++;
+        }
+        for (int t = 0; t < 2; t++)
+            if (p.textures[t] != textures[t])
+            {
+                textures[t] = p.textures[t];
+                state.bindTexture(t, GL_TEXTURE_2D, textures[t]);
+                _stats.texture_binds++;
+                batch_break = true;
+            }
+        if (batch_break)
+        {
+            _stats.batches++;
+            batch_open = true;
+        }
+
+        if (u->model >= 0) glUniformMatrix4fv(u->model, 1, GL_FALSE, &_uniform_data[p.model]);
+        if (p.index_type)
+            glDrawElements(p.mode, p.count, p.index_type, (const void*)p.first);
+        else
+            glDrawArrays(p.mode, (GLint)p.first, p.count);
+        _stats.draws++;
+    }
+}
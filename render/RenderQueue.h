@@ -0,0 +1,129 @@
+#ifndef _CGE_RENDER_QUEUE_H_
+#define _CGE_RENDER_QUEUE_H_
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CGE
+{
+
+class GLStateCache;
+
+enum RenderPass
+{
+    PASS_SHADOW = 0,
+    PASS_OPAQUE,
+    PASS_TRANSPARENT,
+    PASS_OVERLAY,
+};
+
+// 64-bit sort key, most significant bits first:
+//   opaque/shadow/overlay: pass:4 | program:12 | material:16 | depth:24 | unused:8  (front to back inside a batch)
+//   transparent:           pass:4 | depth:24 | program:12 | material:16 | unused:8  (back to front)
+// program and material are sort ids, collisions only cost extra state changes.
+struct SortKey
+{
+    static uint64_t make(RenderPass pass, uint32_t program, uint32_t material, float depth);
+    static RenderPass pass(uint64_t key) { return (RenderPass)(key >> 60); }
+};
+
+struct DrawPacket
+{
+    uint64_t key;
+    GLuint program;
+    GLuint vao;
+    GLuint textures[2];     // diffuse and specular, units 0 and 1
+    GLenum mode;
+    GLenum index_type;      // 0 draws arrays
+    GLsizei count;
+    uintptr_t first;        // first vertex, or byte offset into the index buffer
+    uint32_t model;         // offset of the model matrix in the queue's uniform data
+};
+
+// uniform block slots, the binding index of the block named in include/lighting.glsl etc.
+enum UniformBlock
+{
+    BLOCK_AMBIENT = 0,          // AmbientBlock
+    BLOCK_DIRECTIONAL_LIGHT,    // DirectionalLightBlock
+    BLOCK_POINT_LIGHT,          // PointLightBlock
+    BLOCK_MATERIAL,             // MaterialBlock
+    BLOCK_SHADOW,               // ShadowBlock
+};
+
+// per-view uniforms, set once for every program switch
+struct RenderView
+{
+    static const int kUniformBlocks = BLOCK_SHADOW + 1;
+
+    float view[16];
+    float projection[16];
+    float view_pos[3];
+    // indexed by UniformBlock, bound to those bindings for the whole flush
+    GLuint uniform_buffers[kUniformBlocks];
+    RenderView();
+};
+
+struct RenderQueueStats
+{
+    int packets;
+    int draws;
+    int program_binds;
+    int vao_binds;
+    int texture_binds;
+    int batches;            // runs of packets sharing program and textures
+};
+
+// Draw submission for a frame: packets are collected, radix sorted by key and
+// submitted with state only changed where consecutive packets differ.
+class RenderQueue
+{
+public:
+    RenderQueue();
+
+    void clear();
+    void reserve(size_t packets, size_t floats) { _packets.reserve(packets); _uniform_data.reserve(floats); }
+    // returns the offset to store in DrawPacket::model
+    uint32_t pushMatrix(const float* m);
+    void submit(const DrawPacket& packet) { _packets.push_back(packet); _sorted = false; }
+    // append packets and uniforms recorded elsewhere, model offsets are rebased
+    void append(const std::vector<DrawPacket>& packets, const std::vector<float>& uniforms);
+    // take over recorded packets without copying, the vectors get the old contents back
+    void swapContents(std::vector<DrawPacket>& packets, std::vector<float>& uniforms);
+
+    void sort();
+    // sets blend, depth and cull state for each pass it reaches, left as the last pass had it
+    void flush(const RenderView& view, GLStateCache& state);
+
+    size_t size() const { return _packets.size(); }
+    size_t uniformCount() const { return _uniform_data.size(); }
+    const RenderQueueStats& stats() const { return _stats; }
+
+    // LSD radix sort of keys into order, skipping bytes that are equal for every key
+    static void radixSort(const std::vector<DrawPacket>& packets, std::vector<uint32_t>& order,
+        std::vector<uint64_t>& scratch_keys, std::vector<uint32_t>& scratch_order);
+
+private:
+    struct ProgramUniforms
+    {
+        GLuint program;
+        GLint model, view, projection, view_pos;
+        GLint diffuse, specular;
+    };
+    const ProgramUniforms& uniforms(GLuint program, GLStateCache& state);
+
+    std::vector<DrawPacket> _packets;
+    std::vector<float> _uniform_data;
+    std::vector<uint32_t> _order;
+    std::vector<uint64_t> _scratch_keys;
+    std::vector<uint32_t> _scratch_order;
+    std::vector<ProgramUniforms> _programs;
+    uint32_t _shader_generation;    // ShaderCache::generation() _programs was filled under
+    RenderQueueStats _stats;
+    bool _sorted;
+};
+
+}
+
+#endif
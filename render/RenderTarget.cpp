@@ -0,0 +1,177 @@
+#include <iostream>
+
+#include "render/RenderTarget.h"
+#include "render/GLState.h"
+
+using namespace CGE;
+
+static int roundUp(int size)
+{
+    const int g = RenderTargetPool::kGranularity;
+    return (size <= 0 ? 1 : (size + g - 1) / g) * g;
+}
+
+static size_t bytesPerPixel(GLenum format)
+{
+    switch (format)
+    {
+    case 0: return 0;
+    case GL_RGBA16F: return 8;
+    case GL_RGBA32F: return 16;
+    case GL_R11F_G11F_B10F:
+    case GL_RGB10_A2:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT32F:
+    default: return 4;
+    }
+}
+
+RenderTargetPool::RenderTargetPool():
+    _state(nullptr),
+    _frame(0),
+    _allocations(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    // GL objects are released in destroy(), the context may be gone by now
+    for (Entry* entry : _entries) delete entry;
+}
+
+void RenderTargetPool::init(GLStateCache* state)
+{
+    _state = state;
+}
+
+void RenderTargetPool::destroy()
+{
+    for (Entry* entry : _entries)
+    {
+        destroyTarget(entry->target);
+        delete entry;
+    }
+    _entries.clear();
+}
+
+bool RenderTargetPool::create(RenderTarget& target)
+{
+    const RenderTargetDesc& desc = target.desc;
+    target.color = target.depth = 0;
+    glGenFramebuffers(1, &target.fbo);
+    if (_state) _state->bindFramebuffer(target.fbo);
+    else glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+
+    if (desc.color_format)
+    {
+        glGenTextures(1, &target.color);
+        if (_state) _state->bindTexture(0, GL_TEXTURE_2D, target.color);
+        else glBindTexture(GL_TEXTURE_2D, target.color);
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.color_format, desc.width, desc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.color, 0);
+    }
+    if (desc.depth_format)
+    {
+        glGenRenderbuffers(1, &target.depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, desc.depth_format, desc.width, desc.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        GLenum attachment = desc.depth_format == GL_DEPTH24_STENCIL8 || desc.depth_format == GL_DEPTH32F_STENCIL8 ?
+            GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.depth);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Render target " << desc.width << "x" << desc.height << " incomplete" << std::endl;
+        destroyTarget(target);
+        return false;
+    }
+    _allocations++;
+    return true;
+}
+
+void RenderTargetPool::destroyTarget(RenderTarget& target)
+{
+    if (target.fbo)
+    {
+        glDeleteFramebuffers(1, &target.fbo);
+        if (_state) _state->forgetFramebuffer(target.fbo);
+    }
+    if (target.color)
+    {
+        glDeleteTextures(1, &target.color);
+        if (_state) _state->forgetTexture(target.color);
+    }
+    if (target.depth) glDeleteRenderbuffers(1, &target.depth);
+    target.fbo = target.color = target.depth = 0;
+}
+
+RenderTarget* RenderTargetPool::acquire(const RenderTargetDesc& desc)
+{
+    // smallest free target that fits without wasting too much
+    const double area = (double)roundUp(desc.width) * roundUp(desc.height);
+    Entry* best = nullptr;
+    for (Entry* entry : _entries)
+    {
+        const RenderTargetDesc& have = entry->target.desc;
+        if (entry->in_use || have.color_format != desc.color_format || have.depth_format != desc.depth_format) continue;
+        if (have.width < desc.width || have.height < desc.height) continue;
+        double have_area = (double)have.width * have.height;
+        if (have_area > area * kSlack) continue;
+        if (!best || have_area < (double)best->target.desc.width * best->target.desc.height) best = entry;
+    }
+    if (!best)
+    {
+        best = new Entry();
+        best->target.desc = desc;
+        best->target.desc.width = roundUp(desc.width);
+        best->target.desc.height = roundUp(desc.height);
+        if (!create(best->target))
+        {
+            delete best;
+            return nullptr;
+        }
+        _entries.push_back(best);
+    }
+    best->in_use = true;
+    best->last_used = _frame;
+    return &best->target;
+}
+
+void RenderTargetPool::release(RenderTarget* target)
+{
+    for (Entry* entry : _entries)
+        if (&entry->target == target) entry->in_use = false;
+}
+
+void RenderTargetPool::endFrame()
+{
+    _frame++;
+    for (size_t i = 0; i < _entries.size();)
+    {
+        Entry* entry = _entries[i];
+        if (!entry->in_use && _frame - entry->last_used > (uint64_t)kRetireFrames)
+        {
+            destroyTarget(entry->target);
+            delete entry;
+            _entries[i] = _entries.back();
+            _entries.pop_back();
+        }
+        else i++;
+    }
+}
+
+size_t RenderTargetPool::memory() const
+{
+    size_t bytes = 0;
+    for (const Entry* entry : _entries)
+    {
+        const RenderTargetDesc& desc = entry->target.desc;
+        bytes += (size_t)desc.width * desc.height * (bytesPerPixel(desc.color_format) + bytesPerPixel(desc.depth_format));
+    }
+    return bytes;
+}
@@ -0,0 +1,84 @@
+#ifndef _CGE_RENDER_TARGET_H_
+#define _CGE_RENDER_TARGET_H_
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <vector>
+
+namespace CGE
+{
+
+class GLStateCache;
+
+struct RenderTargetDesc
+{
+    int width, height;
+    GLenum color_format;    // texture, sampled by ImGui or later passes; 0 for none
+    GLenum depth_format;    // renderbuffer; 0 for none
+
+    RenderTargetDesc(int w = 0, int h = 0, GLenum color = GL_RGBA8, GLenum depth = GL_DEPTH24_STENCIL8):
+        width(w), height(h), color_format(color), depth_format(depth) {}
+};
+
+// A framebuffer at least as large as requested, drawing covers the
+// requested size from the bottom left corner.
+struct RenderTarget
+{
+    RenderTargetDesc desc;  // allocated size
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+
+    // texture coordinates of a w x h region, for sampling it
+    float u(int w) const { return (float)w / desc.width; }
+    float v(int h) const { return (float)h / desc.height; }
+};
+
+// Render targets keyed by size and format. Sizes round up to kGranularity and
+// a free target up to kSlack times the requested area is reused, so resizing a
+// window allocates every few dozen pixels instead of every frame. Targets
+// unused for kRetireFrames are deleted at endFrame().
+class RenderTargetPool
+{
+public:
+    static const int kGranularity = 64;
+    static const int kRetireFrames = 120;
+    static constexpr float kSlack = 2.0f;
+
+    RenderTargetPool();
+    ~RenderTargetPool();
+
+    // state, when given, is used for the framebuffer binds and told about deletions
+    void init(GLStateCache* state);
+    void destroy();
+
+    // context thread; the target stays reserved until release()
+    RenderTarget* acquire(const RenderTargetDesc& desc);
+    void release(RenderTarget* target);
+    void endFrame();
+
+    size_t count() const { return _entries.size(); }
+    size_t allocations() const { return _allocations; }
+    // bytes held by all targets
+    size_t memory() const;
+
+private:
+    struct Entry
+    {
+        RenderTarget target;
+        bool in_use;
+        uint64_t last_used;
+    };
+
+    bool create(RenderTarget& target);
+    void destroyTarget(RenderTarget& target);
+
+    GLStateCache* _state;
+    std::vector<Entry*> _entries;
+    uint64_t _frame;
+    size_t _allocations;
+};
+
+}
+
+#endif
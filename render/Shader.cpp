@@ -0,0 +1,487 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <climits>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#include "render/Shader.h"
+#include "render/ShaderSource.h"
+#include "render/GLExt.h"
+#include "render/GLState.h"
+#include "utils/utils.h"
+
+using namespace CGE;
+
+static const char kBinaryMagic[8] = { 'C', 'G', 'E', 'P', 'R', 'O', 'G', '1' };
+// poll() time without KHR_parallel_shader_compile, where finishing a program blocks
+static const double kPollBudgetMs = 2.0;
+// polls a replaced program survives, packets recorded a frame ahead may still name it
+static const int kRetirePolls = 2;
+
+// defines go right after #version, which has to stay the first statement
+static std::string applyDefines(const std::string& source, const std::vector<std::string>& defines)
+{
+    if (defines.empty()) return source;
+    size_t insert = 0, line = 1;
+    if (source.compare(0, 8, "#version") == 0)
+    {
+        insert = source.find('\n');
+        insert = insert == std::string::npos ? source.size() : insert + 1;
+        line = 2;
+    }
+    std::string text = source.substr(0, insert);
+    if (insert == source.size() && !text.empty() && text.back() != '\n') text += '\n';
+    for (const std::string& define : defines) text += "#define " + define + "\n";
+    // keep compiler messages on the file's own line numbers
+    text += "#line " + std::to_string(line) + "\n";
+    text += source.substr(insert);
+    return text;
+}
+
+static std::string canonical(const std::string& path)
+{
+    char resolved[PATH_MAX];
+    return realpath(path.c_str(), resolved) ? std::string(resolved) : path;
+}
+
+static bool isAbsolute(const std::string& path)
+{
+    return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+}
+
+const std::string& Shader::path() const
+{
+    static const std::string empty;
+    return _program ? _program->path : empty;
+}
+
+Shader Shader::Find(const std::string& path, const std::vector<std::string>& defines)
+{
+    return ShaderCache::Instance().find(path, defines);
+}
+
+ShaderProgram* Shader::resolve() const
+{
+    if (_program && _program->pending && !_program->program) return ShaderCache::Instance().fallback();
+    return _program;
+}
+
+GLuint Shader::program() const
+{
+    ShaderProgram* program = resolve();
+    return program ? program->program.load() : 0;
+}
+
+GLint Shader::uniform(const char* name) const
+{
+    ShaderProgram* program = resolve();
+    if (!program || !program->program) return -1;
+    auto it = program->uniforms.find(name);
+    if (it != program->uniforms.end()) return it->second;
+    GLint location = glGetUniformLocation(program->program, name);
+    program->uniforms[name] = location;
+    return location;
+}
+
+void Shader::use(GLStateCache* state) const
+{
+    if (state) state->useProgram(program());
+    else glUseProgram(program());
+}
+
+ShaderCache& ShaderCache::Instance()
+{
+    static ShaderCache cache;
+    return cache;
+}
+
+ShaderCache::ShaderCache():
+    _driver_hash(0),
+    _fallback(nullptr),
+    _generation(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void ShaderCache::init(const std::string& binary_dir)
+{
+    // let the driver pick how many threads compile in the background
+    if (glExtensions().parallel_shader_compile) glExtensions().MaxShaderCompilerThreads(0xffffffffu);
+
+    _binary_dir.clear();
+    if (binary_dir.empty() || !glExtensions().program_binary) return;
+    _binary_dir = binary_dir;
+    mkdir(_binary_dir.c_str(), 0755);
+
+    // a binary is only good for the driver that produced it
+    uint64_t hash = kShaderHashSeed;
+    const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (GLenum name : strings)
+    {
+        const char* s = (const char*)glGetString(name);
+        hash = shaderHash(s ? s : "", hash);
+    }
+    _driver_hash = hash;
+}
+
+void ShaderCache::destroy()
+{
+    // GL objects are released here, handles from find() are dangling afterwards
+    for (auto& it : _programs)
+    {
+        ShaderProgram& entry = *it.second;
+        if (entry.program) glDeleteProgram(entry.program);
+        if (entry.pending) glDeleteProgram(entry.pending);
+        for (GLuint stage : entry.stages)
+            if (stage) glDeleteShader(stage);
+    }
+    for (const RetiredProgram& retired : _retired) glDeleteProgram(retired.program);
+    _programs.clear();
+    _pending.clear();
+    _retired.clear();
+    _generation++;
+    _fallback = nullptr;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+Shader ShaderCache::find(const std::string& path, const std::vector<std::string>& defines)
+{
+    Shader shader = request(path, defines);
+    if (shader._program->pending) finish(*shader._program);
+    return shader;
+}
+
+Shader ShaderCache::request(const std::string& path, const std::vector<std::string>& defines)
+{
+    std::vector<std::string> sorted(defines);
+    std::sort(sorted.begin(), sorted.end());
+    std::string key = path;
+    for (const std::string& define : sorted) key += "|" + define;
+    auto it = _programs.find(key);
+    if (it != _programs.end()) return Shader(it->second.get());
+
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<ShaderProgram> entry(new ShaderProgram());
+    entry->path = path;
+    entry->defines = sorted;
+    entry->source_hash = 0;
+    entry->program = 0;
+    entry->pending = 0;
+    entry->stages[0] = entry->stages[1] = 0;
+
+    std::string vertex, fragment;
+    if (loadSources(*entry, &vertex, &fragment, &entry->source_hash))
+    {
+        if (loadBinary(*entry))
+            _stats.from_binary++;
+        else
+            compile(*entry, vertex, fragment);
+    }
+    if (!entry->program && !entry->pending) _stats.failed++;
+    _stats.programs++;
+    _stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    ShaderProgram* program = entry.get();
+    _programs[key] = std::move(entry);
+    if (program->pending) _pending.push_back(program);
+    _stats.pending = (int)_pending.size();
+    return Shader(program);
+}
+
+int ShaderCache::poll()
+{
+    // names are only freed here, after every frame that could use them was drawn
+    size_t kept = 0;
+    for (RetiredProgram& retired : _retired)
+    {
+        if (++retired.polls < kRetirePolls) _retired[kept++] = retired;
+        else glDeleteProgram(retired.program);
+    }
+    if (kept != _retired.size())
+    {
+        _retired.resize(kept);
+        _generation++;
+    }
+
+    if (_pending.empty()) return 0;
+    auto start = std::chrono::steady_clock::now();
+    const bool parallel = glExtensions().parallel_shader_compile;
+    int finished = 0;
+    std::vector<ShaderProgram*> pending(_pending);
+    for (ShaderProgram* entry : pending)
+    {
+        if (parallel)
+        {
+            GLint done = 0;
+            glGetProgramiv(entry->pending, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done) continue;
+        }
+        else if (finished > 0 &&
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() > kPollBudgetMs)
+            break;
+        finish(*entry);
+        finished++;
+    }
+    return (int)_pending.size();
+}
+
+bool ShaderCache::loadSources(ShaderProgram& entry, std::string* vertex, std::string* fragment, uint64_t* hash)
+{
+    // relative paths are tried from the working directory, then next to the executable;
+    // embedded shaders answer from the first lookup
+    std::string path = entry.path;
+    std::string vertex_file = findShaderStage(path, false);
+    if (vertex_file.empty() && !isAbsolute(path))
+    {
+        path = Utils::getProgramPath() + "/" + path;
+        vertex_file = findShaderStage(path, false);
+    }
+    if (vertex_file.empty())
+    {
+        std::cout << "Shader " << entry.path << ": no vertex shader" << std::endl;
+        return false;
+    }
+    // vertex-only variants (Unlit_packed) share the fragment shader of their base name
+    std::string fragment_file = findShaderStage(path, true);
+    if (fragment_file.empty())
+    {
+        std::cout << "Shader " << entry.path << ": no fragment shader" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> keywords, included, files;
+    vertex->clear();
+    fragment->clear();
+    if (!preprocessShader(vertex_file, vertex, &keywords, included)) return false;
+    files.swap(included);
+    if (!preprocessShader(fragment_file, fragment, &keywords, included)) return false;
+    files.insert(files.end(), included.begin(), included.end());
+    entry.files.clear();
+    for (const std::string& file : files)
+    {
+        std::string path = canonical(file);
+        if (std::find(entry.files.begin(), entry.files.end(), path) == entry.files.end())
+            entry.files.push_back(path);
+    }
+
+    // a misspelt keyword would silently compile the default variant
+    if (!keywords.empty())
+        for (const std::string& define : entry.defines)
+        {
+            std::string name = define.substr(0, define.find_first_of(" ="));
+            if (std::find(keywords.begin(), keywords.end(), name) == keywords.end())
+                std::cout << "Shader " << entry.path << ": " << name << " is not one of its keywords" << std::endl;
+        }
+
+    // embedded stages come with the hash of their text from the build
+    const EmbeddedShader* embedded[2] = { findEmbeddedShader(vertex_file), findEmbeddedShader(fragment_file) };
+    if (embedded[0] && embedded[1])
+    {
+        *hash = shaderHashBytes(&embedded[0]->hash, sizeof(uint64_t));
+        *hash = shaderHashBytes(&embedded[1]->hash, sizeof(uint64_t), *hash);
+        for (const std::string& define : entry.defines) *hash = shaderHash(define, *hash);
+    }
+    *vertex = applyDefines(*vertex, entry.defines);
+    *fragment = applyDefines(*fragment, entry.defines);
+    if (!embedded[0] || !embedded[1]) *hash = shaderHash(*fragment, shaderHash(*vertex));
+    return true;
+}
+
+std::string ShaderCache::binaryPath(const ShaderProgram& entry) const
+{
+    // named by path and defines, so an edited shader replaces its old binary
+    uint64_t key = shaderHash(entry.path);
+    for (const std::string& define : entry.defines) key = shaderHash(define, key);
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return _binary_dir + name;
+}
+
+bool ShaderCache::loadBinary(ShaderProgram& entry)
+{
+    if (_binary_dir.empty()) return false;
+    std::string data;
+    if (!readShaderFile(binaryPath(entry), &data)) return false;
+
+    const size_t header = sizeof(kBinaryMagic) + 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    if (data.size() < header || memcmp(data.data(), kBinaryMagic, sizeof(kBinaryMagic))) return false;
+    uint64_t driver, source;
+    uint32_t format, length;
+    const char* p = data.data() + sizeof(kBinaryMagic);
+    memcpy(&driver, p, sizeof(driver)); p += sizeof(driver);
+    memcpy(&source, p, sizeof(source)); p += sizeof(source);
+    memcpy(&format, p, sizeof(format)); p += sizeof(format);
+    memcpy(&length, p, sizeof(length)); p += sizeof(length);
+    if (driver != _driver_hash || source != entry.source_hash || data.size() - header != length) return false;
+
+    GLuint program = glCreateProgram();
+    glExtensions().ProgramBinary(program, format, p, (GLsizei)length);
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok)
+    {
+        // the driver may reject its own binaries after an update we could not see
+        glDeleteProgram(program);
+        return false;
+    }
+    entry.program = program;
+    return true;
+}
+
+void ShaderCache::saveBinary(const ShaderProgram& entry)
+{
+    if (_binary_dir.empty()) return;
+    GLint length = 0;
+    glGetProgramiv(entry.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glExtensions().GetProgramBinary(entry.program, length, &written, &format, binary.data());
+    if (written <= 0) return;
+
+    std::string path = binaryPath(entry);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return;
+    uint32_t format32 = format, length32 = (uint32_t)written;
+    bool ok = fwrite(kBinaryMagic, sizeof(kBinaryMagic), 1, file) == 1 &&
+        fwrite(&_driver_hash, sizeof(_driver_hash), 1, file) == 1 &&
+        fwrite(&entry.source_hash, sizeof(entry.source_hash), 1, file) == 1 &&
+        fwrite(&format32, sizeof(format32), 1, file) == 1 &&
+        fwrite(&length32, sizeof(length32), 1, file) == 1 &&
+        fwrite(binary.data(), 1, written, file) == (size_t)written;
+    fclose(file);
+    // a truncated file would only fail the length check, but do not leave it around
+    if (!ok) remove(path.c_str());
+}
+
+static GLuint compileStage(GLenum type, const std::string& source)
+{
+    GLuint shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+void ShaderCache::compile(ShaderProgram& entry, const std::string& vertex, const std::string& fragment)
+{
+    // no status queries here, they would wait for the compiler
+    entry.stages[0] = compileStage(GL_VERTEX_SHADER, vertex);
+    entry.stages[1] = compileStage(GL_FRAGMENT_SHADER, fragment);
+    entry.pending = glCreateProgram();
+    glAttachShader(entry.pending, entry.stages[0]);
+    glAttachShader(entry.pending, entry.stages[1]);
+    if (!_binary_dir.empty()) glExtensions().ProgramParameteri(entry.pending, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(entry.pending);
+}
+
+void ShaderCache::finish(ShaderProgram& entry)
+{
+    auto start = std::chrono::steady_clock::now();
+    GLint ok = 0;
+    glGetProgramiv(entry.pending, GL_LINK_STATUS, &ok);
+    if (ok)
+    {
+        if (entry.program)
+        {
+            // the swap happens between frames, handles pick up the new program on their next use;
+            // the old one is deleted by a later poll()
+            RetiredProgram retired = { entry.program, 0 };
+            _retired.push_back(retired);
+            entry.uniforms.clear();
+            _stats.reloaded++;
+            std::cout << "Shader reloaded: " << entry.path << std::endl;
+        }
+        else
+            _stats.compiled++;
+        // set before pending clears, so other threads see the fallback or this program, never 0
+        entry.program = entry.pending.load();
+        for (GLuint stage : entry.stages) glDetachShader(entry.program, stage);
+        saveBinary(entry);
+    }
+    else
+    {
+        // the compile logs say more than the link log
+        char log[1024];
+        for (int i = 0; i < 2; i++)
+        {
+            GLint compiled = 0;
+            glGetShaderiv(entry.stages[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled) continue;
+            glGetShaderInfoLog(entry.stages[i], sizeof(log), nullptr, log);
+            std::cout << "Shader " << entry.path << (i == 0 ? " (vertex): " : " (fragment): ") << log << std::endl;
+            ok = -1;
+        }
+        if (ok == 0)
+        {
+            glGetProgramInfoLog(entry.pending, sizeof(log), nullptr, log);
+            std::cout << "Shader program " << entry.path << ": " << log << std::endl;
+        }
+        glDeleteProgram(entry.pending);
+        if (entry.program) std::cout << "Shader " << entry.path << ": keeping the previous program" << std::endl;
+        else _stats.failed++;
+    }
+    for (GLuint& stage : entry.stages)
+    {
+        glDeleteShader(stage);
+        stage = 0;
+    }
+    entry.pending = 0;
+    _pending.erase(std::find(_pending.begin(), _pending.end(), &entry));
+    _stats.pending = (int)_pending.size();
+    _stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int ShaderCache::precompile(const std::string& dir, bool async)
+{
+    std::vector<std::string> stems = listShaderPrograms(dir);
+
+    // async returns the number issued, their results come with poll()
+    int count = 0;
+    for (const std::string& stem : stems)
+    {
+        Shader shader = async ? request(stem) : find(stem);
+        if (shader.valid() || !shader.ready()) count++;
+    }
+    return count;
+}
+
+int ShaderCache::reload(const std::vector<std::string>& changed)
+{
+    std::vector<std::string> files;
+    for (const std::string& file : changed) files.push_back(canonical(file));
+
+    int count = 0;
+    for (auto& it : _programs)
+    {
+        ShaderProgram& entry = *it.second;
+        bool affected = false;
+        for (const std::string& file : entry.files)
+            affected = affected || std::find(files.begin(), files.end(), file) != files.end();
+        if (!affected) continue;
+
+        // an earlier edit still compiling is finished first, the new compile replaces it
+        if (entry.pending) finish(entry);
+        auto start = std::chrono::steady_clock::now();
+        std::string vertex, fragment;
+        uint64_t hash = 0;
+        if (loadSources(entry, &vertex, &fragment, &hash))
+        {
+            // editors often save without changes
+            if (hash != entry.source_hash || !entry.program)
+            {
+                entry.source_hash = hash;
+                compile(entry, vertex, fragment);
+                _pending.push_back(&entry);
+                count++;
+            }
+        }
+        _stats.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    _stats.pending = (int)_pending.size();
+    return count;
+}
@@ -0,0 +1,140 @@
+#ifndef _CGE_SHADER_H_
+#define _CGE_SHADER_H_
+
+#include <glad/gl.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CGE
+{
+
+class GLStateCache;
+
+struct ShaderProgram
+{
+    std::string path;                   // without extension, path.vert/.vs and path.frag/.fs
+    std::vector<std::string> defines;   // sorted, each becomes a #define after #version
+    uint64_t source_hash;               // sources and defines, keys the binary cache
+    std::vector<std::string> files;     // every file read, includes too, canonical paths
+    // written by the context thread, read by recording threads through Shader::program()
+    std::atomic<GLuint> program;        // 0 when compilation failed or is still running
+    std::atomic<GLuint> pending;        // program being compiled and linked, 0 once finished
+    GLuint stages[2];                   // its vertex and fragment shader
+    std::unordered_map<std::string, GLint> uniforms;
+};
+
+// Handle to a cached program, cheap to copy. Stays valid until
+// ShaderCache::destroy(), an empty handle has program() 0. While a requested
+// program is still compiling the handle stands for the cache's fallback; a
+// reload swaps the program underneath it, so keep locations from uniform().
+// valid(), ready() and program() may be called from any thread, e.g. to fill a
+// DrawPacket on a worker recorder; everything else is context thread only.
+class Shader
+{
+public:
+    Shader(): _program(nullptr) {}
+
+    // context thread: the program for path with these defines, compiled on first use.
+    // Defines are "NAME" or "NAME value"; shaders that list #pragma keywords warn
+    // about names not on the list. Sources may #include "file" relative to themselves.
+    static Shader Find(const std::string& path, const std::vector<std::string>& defines = {});
+
+    bool valid() const { return _program && _program->program; }
+    bool ready() const { return _program && !_program->pending; }
+    // the fallback's program while this one compiles
+    GLuint program() const;
+    const std::string& path() const;
+    // context thread, looked up once per name, -1 when the program has no such uniform
+    GLint uniform(const char* name) const;
+    void use(GLStateCache* state = nullptr) const;
+
+private:
+    friend class ShaderCache;
+    explicit Shader(ShaderProgram* program): _program(program) {}
+    ShaderProgram* resolve() const;
+
+    ShaderProgram* _program;
+};
+
+struct ShaderCacheStats
+{
+    int programs;
+    int compiled;       // built from GLSL
+    int from_binary;    // loaded from the program-binary cache
+    int failed;
+    int pending;        // requested and not finished yet
+    int reloaded;       // swapped in after a source change
+    double ms;          // context thread time in the cache, compiles and binary loads included
+};
+
+// Programs keyed by path and defines. With ARB_get_program_binary, linked
+// programs are written to the cache directory as <hash>.bin and loaded from
+// there on later runs; a file is only used when its source hash and the
+// GL vendor/renderer/version string match, so any shader edit or driver
+// update falls back to compiling.
+//
+// request() only issues the compile and link; poll() picks up what the driver
+// has finished, asking with KHR_parallel_shader_compile so it never blocks.
+// Without the extension each poll() finishes programs until a small time budget
+// is spent, spreading the wait over frames.
+class ShaderCache
+{
+public:
+    static ShaderCache& Instance();
+
+    // context thread, after loadGLExtensions(); empty binary_dir disables the disk cache
+    void init(const std::string& binary_dir);
+    void destroy();
+
+    // blocks until the program is linked
+    Shader find(const std::string& path, const std::vector<std::string>& defines = {});
+    // returns at once, the handle draws with the fallback until a poll() finishes it
+    Shader request(const std::string& path, const std::vector<std::string>& defines = {});
+    void setFallback(const Shader& shader) { _fallback = shader._program; }
+    ShaderProgram* fallback() const { return _fallback; }
+    // context thread, once per frame; returns the number of programs still compiling
+    int poll();
+    // every vertex/fragment pair under dir, for a cold start that pays for all compiles at once
+    int precompile(const std::string& dir, bool async = false);
+    // recompiles the programs built from any of these files; poll() swaps each
+    // in once linked, one that fails keeps its previous program. Returns the count issued.
+    int reload(const std::vector<std::string>& changed);
+
+    ShaderCacheStats stats() const { return _stats; }
+    // context thread; changes whenever program names are deleted and may be reused,
+    // anything caching state by program name drops it then
+    uint32_t generation() const { return _generation; }
+
+private:
+    struct RetiredProgram
+    {
+        GLuint program;
+        int polls;
+    };
+
+    ShaderCache();
+
+    bool loadSources(ShaderProgram& entry, std::string* vertex, std::string* fragment, uint64_t* hash);
+    bool loadBinary(ShaderProgram& entry);
+    void saveBinary(const ShaderProgram& entry);
+    void compile(ShaderProgram& entry, const std::string& vertex, const std::string& fragment);
+    void finish(ShaderProgram& entry);
+    std::string binaryPath(const ShaderProgram& entry) const;
+
+    std::string _binary_dir;
+    uint64_t _driver_hash;
+    std::unordered_map<std::string, std::unique_ptr<ShaderProgram>> _programs;
+    std::vector<ShaderProgram*> _pending;
+    ShaderProgram* _fallback;
+    std::vector<RetiredProgram> _retired;   // replaced by a reload, deleted a few polls later
+    uint32_t _generation;
+    ShaderCacheStats _stats;
+};
+
+}
+
+#endif
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+
+#include "render/ShaderSource.h"
+
+using namespace CGE;
+
+static const char* const kVertexExtensions[] = { ".vert", ".vs", nullptr };
+static const char* const kFragmentExtensions[] = { ".frag", ".fs", nullptr };
+
+// empty unless setEmbeddedShaderRoot() succeeded
+static std::string s_embedded_root;
+
+uint64_t CGE::shaderHashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+uint64_t CGE::shaderHash(const std::string& s, uint64_t hash)
+{
+    return shaderHashBytes(s.c_str(), s.size() + 1, hash);
+}
+
+bool CGE::setEmbeddedShaderRoot(const std::string& root)
+{
+#ifdef CGE_EMBED_SHADERS
+    s_embedded_root = root;
+    return true;
+#else
+    (void)root;
+    return false;
+#endif
+}
+
+const EmbeddedShader* CGE::findEmbeddedShader(const std::string& path)
+{
+#ifdef CGE_EMBED_SHADERS
+    if (s_embedded_root.empty() || path.size() <= s_embedded_root.size() + 1 ||
+        path.compare(0, s_embedded_root.size(), s_embedded_root) != 0 || path[s_embedded_root.size()] != '/')
+        return nullptr;
+    const char* name = path.c_str() + s_embedded_root.size() + 1;
+    for (size_t i = 0; i < kEmbeddedShaderCount; i++)
+        if (!strcmp(kEmbeddedShaders[i].name, name)) return &kEmbeddedShaders[i];
+#else
+    (void)path;
+#endif
+    return nullptr;
+}
+
+bool CGE::readShaderFile(const std::string& path, std::string* out)
+{
+    if (const EmbeddedShader* shader = findEmbeddedShader(path))
+    {
+        out->assign(shader->source, shader->size);
+        return true;
+    }
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    out->resize(size > 0 ? (size_t)size : 0);
+    size_t read = out->empty() ? 0 : fread(&(*out)[0], 1, out->size(), file);
+    fclose(file);
+    return read == out->size();
+}
+
+// first of path + extensions that exists, empty when none does
+static std::string findStage(const std::string& path, const char* const* extensions)
+{
+    for (; *extensions; extensions++)
+    {
+        if (findEmbeddedShader(path + *extensions)) return path + *extensions;
+        if (FILE* file = fopen((path + *extensions).c_str(), "rb"))
+        {
+            fclose(file);
+            return path + *extensions;
+        }
+    }
+    return std::string();
+}
+
+std::string CGE::findShaderStage(const std::string& path, bool fragment)
+{
+    if (!fragment) return findStage(path, kVertexExtensions);
+    std::string file = findStage(path, kFragmentExtensions);
+    if (!file.empty()) return file;
+    size_t slash = path.find_last_of("\\/");
+    size_t underscore = path.find_last_of('_');
+    if (underscore != std::string::npos && (slash == std::string::npos || underscore > slash))
+        file = findStage(path.substr(0, underscore), kFragmentExtensions);
+    return file;
+}
+
+static bool isVertexFile(const std::string& name, std::string* stem)
+{
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = name.substr(dot);
+    *stem = name.substr(0, dot);
+    return extension == ".vert" || extension == ".vs";
+}
+
+std::vector<std::string> CGE::listShaderPrograms(const std::string& dir)
+{
+    std::vector<std::string> stems;
+    std::string stem;
+#ifdef CGE_EMBED_SHADERS
+    if (!s_embedded_root.empty() && dir == s_embedded_root)
+    {
+        for (size_t i = 0; i < kEmbeddedShaderCount; i++)
+            if (!strchr(kEmbeddedShaders[i].name, '/') && isVertexFile(kEmbeddedShaders[i].name, &stem))
+                stems.push_back(dir + "/" + stem);
+        std::sort(stems.begin(), stems.end());
+        return stems;
+    }
+#endif
+    DIR* handle = opendir(dir.c_str());
+    if (!handle)
+    {
+        std::cout << "Cannot open shader directory " << dir << std::endl;
+        return stems;
+    }
+    while (dirent* e = readdir(handle))
+        if (isVertexFile(e->d_name, &stem)) stems.push_back(dir + "/" + stem);
+    closedir(handle);
+    std::sort(stems.begin(), stems.end());
+    stems.erase(std::unique(stems.begin(), stems.end()), stems.end());
+    return stems;
+}
+
+bool CGE::preprocessShader(const std::string& file, std::string* out, std::vector<std::string>* keywords,
+    std::vector<std::string>& included, int depth)
+{
+    if (std::find(included.begin(), included.end(), file) != included.end()) return true;
+    included.push_back(file);
+    std::string source;
+    if (!readShaderFile(file, &source))
+    {
+        std::cout << "Shader: cannot read " << file << std::endl;
+        return false;
+    }
+    size_t slash = file.find_last_of("\\/");
+    std::string dir = slash == std::string::npos ? std::string() : file.substr(0, slash + 1);
+
+    size_t start = 0;
+    int line = 1;
+    while (start < source.size())
+    {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos) end = source.size();
+        std::string text = source.substr(start, end - start);
+        size_t first = text.find_first_not_of(" \t");
+        if (first != std::string::npos && text.compare(first, 8, "#include") == 0)
+        {
+            size_t open = text.find('"', first + 8);
+            size_t close = open == std::string::npos ? open : text.find('"', open + 1);
+            if (close == std::string::npos || depth >= 16)
+            {
+                std::cout << "Shader " << file << ":" << line << ": bad #include" << std::endl;
+                return false;
+            }
+            out->append("#line 1\n");
+            if (!preprocessShader(dir + text.substr(open + 1, close - open - 1), out, keywords, included, depth + 1))
+                return false;
+            out->append("#line " + std::to_string(line + 1) + "\n");
+        }
+        else
+        {
+            // the line stays, GLSL ignores pragmas it does not know and embedded
+            // sources still carry their keywords this way
+            if (first != std::string::npos && text.compare(first, 16, "#pragma keywords") == 0)
+            {
+                size_t pos = first + 16;
+                while ((pos = text.find_first_not_of(" \t\r", pos)) != std::string::npos)
+                {
+                    size_t stop = text.find_first_of(" \t\r", pos);
+                    keywords->push_back(text.substr(pos, stop - pos));
+                    pos = stop;
+                }
+            }
+            out->append(text);
+            out->append("\n");
+        }
+        start = end + 1;
+        line++;
+    }
+    return true;
+}
+
+std::string CGE::stripShaderComments(const std::string& source)
+{
+    std::string out;
+    out.reserve(source.size());
+    bool block = false, quoted = false;
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        char c = source[i];
+        char next = i + 1 < source.size() ? source[i + 1] : '\0';
+        if (c == '\n')
+        {
+            // line breaks survive inside block comments too, line numbers stay put
+            while (!out.empty() && (out.back() == ' ' || out.back() == '\t' || out.back() == '\r')) out.pop_back();
+            out += '\n';
+            quoted = false;
+        }
+        else if (block)
+        {
+            if (c == '*' && next == '/')
+            {
+                block = false;
+                i++;
+                // a comment between two tokens must not join them
+                out += ' ';
+            }
+        }
+        else if (!quoted && c == '/' && next == '/')
+        {
+            while (i + 1 < source.size() && source[i + 1] != '\n') i++;
+        }
+        else if (!quoted && c == '/' && next == '*')
+        {
+            block = true;
+            i++;
+        }
+        else
+        {
+            // only #include and #line take strings in GLSL
+            if (c == '"') quoted = !quoted;
+            out += c;
+        }
+    }
+    while (!out.empty() && (out.back() == ' ' || out.back() == '\t' || out.back() == '\r')) out.pop_back();
+    return out;
+}
+
+bool CGE::validateShader(const std::string& source, const std::string& name, bool stage)
+{
+    bool ok = true;
+    auto error = [&](int line, const std::string& message)
+    {
+        std::cout << name << ":" << line << ": " << message << std::endl;
+        ok = false;
+    };
+
+    int versions = 0, braces = 0, parens = 0, line = 1, statements = 0;
+    bool has_main = false;
+    std::vector<int> conditionals;
+    size_t start = 0;
+    while (start < source.size())
+    {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos) end = source.size();
+        std::string text = source.substr(start, end - start);
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first != std::string::npos && text[first] == '#')
+        {
+            size_t word = text.find_first_not_of(" \t", first + 1);
+            std::string directive = word == std::string::npos ? std::string() :
+                text.substr(word, text.find_first_of(" \t\r(", word) - word);
+            if (directive == "version")
+            {
+                if (versions++ > 0) error(line, "second #version");
+                else if (stage && statements > 0) error(line, "#version is not the first statement");
+            }
+            else if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+                conditionals.push_back(line);
+            else if (directive == "else" || directive == "elif" || directive == "endif")
+            {
+                if (conditionals.empty()) error(line, "#" + directive + " without #if");
+                else if (directive == "endif") conditionals.pop_back();
+            }
+            statements++;
+        }
+        else if (first != std::string::npos)
+        {
+            for (size_t i = first; i < text.size(); i++)
+            {
+                char c = text[i];
+                if (c == '{') braces++;
+                else if (c == '}' && --braces < 0) { error(line, "unmatched }"); braces = 0; }
+                else if (c == '(') parens++;
+                else if (c == ')' && --parens < 0) { error(line, "unmatched )"); parens = 0; }
+            }
+            size_t main = text.find("main");
+            if (main != std::string::npos && (main == 0 || !(isalnum((unsigned char)text[main - 1]) || text[main - 1] == '_')) &&
+                text.find_first_not_of(" \t", main + 4) != std::string::npos && text[text.find_first_not_of(" \t", main + 4)] == '(')
+                has_main = true;
+            statements++;
+        }
+        start = end + 1;
+        line++;
+    }
+    if (stage && versions == 0) error(1, "no #version");
+    if (!stage && versions > 0) error(1, "#version in an included file");
+    for (int open : conditionals) error(open, "#if without #endif");
+    if (braces != 0) error(line, "unbalanced braces");
+    if (parens != 0) error(line, "unbalanced parentheses");
+    if (stage && !has_main) error(line, "no main()");
+    return ok;
+}
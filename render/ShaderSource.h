@@ -0,0 +1,64 @@
+#ifndef _CGE_SHADER_SOURCE_H_
+#define _CGE_SHADER_SOURCE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GLSL source handling shared by ShaderCache and the ShaderEmbed build tool,
+// no GL calls in here.
+
+namespace CGE
+{
+
+static const uint64_t kShaderHashSeed = 14695981039346656037ull;
+
+// FNV-1a, strings include their terminator so "ab" + "c" differs from "a" + "bc"
+uint64_t shaderHashBytes(const void* data, size_t size, uint64_t hash = kShaderHashSeed);
+uint64_t shaderHash(const std::string& s, uint64_t hash = kShaderHashSeed);
+
+// A stage file preprocessed at build time, see embed_shaders.cpp
+struct EmbeddedShader
+{
+    const char* name;       // relative to data/shader, "lit.frag"
+    const char* source;     // includes resolved, comments stripped
+    size_t size;
+    uint64_t hash;          // shaderHash() of source
+};
+
+#ifdef CGE_EMBED_SHADERS
+// generated by ShaderEmbed into the build directory
+extern const EmbeddedShader kEmbeddedShaders[];
+extern const size_t kEmbeddedShaderCount;
+#endif
+
+// Serves root/<name> from the shaders compiled into the binary instead of the
+// file system; only available in builds configured with CGE_EMBED_SHADERS.
+bool setEmbeddedShaderRoot(const std::string& root);
+const EmbeddedShader* findEmbeddedShader(const std::string& path);
+
+// embedded first, then the file system
+bool readShaderFile(const std::string& path, std::string* out);
+// path + .vert/.vs or path + .frag/.fs, empty when there is none. A vertex-only
+// variant path_suffix (Unlit_packed) gets the fragment stage of its base name.
+std::string findShaderStage(const std::string& path, bool fragment);
+// stems of every program in dir, path + name without extension
+std::vector<std::string> listShaderPrograms(const std::string& dir);
+
+// Resolves #include "file" relative to the including file, each file at most
+// once per stage, and collects the names on #pragma keywords lines. Included
+// text is wrapped in #line directives so compiler messages keep each file's
+// own line numbers. included returns every file read.
+bool preprocessShader(const std::string& file, std::string* out, std::vector<std::string>* keywords,
+    std::vector<std::string>& included, int depth = 0);
+
+// removes // and /* */ comments and trailing blanks, keeping every line break
+std::string stripShaderComments(const std::string& source);
+// balanced braces, parentheses and #if/#endif; a stage also needs #version first
+// and only once and a main(), an include neither. Prints name:line per error.
+bool validateShader(const std::string& source, const std::string& name, bool stage = true);
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include <cstring>
+#include <iostream>
+
+#include "render/StreamBuffer.h"
+#include "render/GLExt.h"
+#include "render/GLState.h"
+
+using namespace CGE;
+
+StreamBuffer::StreamBuffer():
+    _mode(MODE_NONE),
+    _state(nullptr),
+    _buffer(0),
+    _persistent(nullptr),
+    _frame_size(0),
+    _frame(0),
+    _frame_begin(0),
+    _head(0),
+    _mapped(false),
+    _overflow(false)
+{
+    for (GLsync& fence : _fences) fence = 0;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    // GL objects are released in destroy(), the context may be gone by now
+}
+
+void StreamBuffer::bind()
+{
+    if (_state) _state->bindBuffer(GL_ARRAY_BUFFER, _buffer);
+    else glBindBuffer(GL_ARRAY_BUFFER, _buffer);
+}
+
+bool StreamBuffer::init(GLsizeiptr frame_size, GLStateCache* state)
+{
+    _state = state;
+    _frame_size = frame_size;
+    const GLExtensions& ext = glExtensions();
+    if (ext.buffer_storage && ext.sync) _mode = MODE_PERSISTENT;
+    else if (ext.sync) _mode = MODE_UNSYNCHRONIZED;
+    else _mode = MODE_ORPHAN;
+    create();
+    return _buffer != 0;
+}
+
+void StreamBuffer::create()
+{
+    glGenBuffers(1, &_buffer);
+    bind();
+    GLsizeiptr total = _mode == MODE_ORPHAN ? _frame_size : _frame_size * kFrames;
+    if (_mode == MODE_PERSISTENT)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glExtensions().BufferStorage(GL_ARRAY_BUFFER, total, nullptr, flags);
+        _persistent = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+        if (!_persistent)
+        {
+            std::cout << "Persistent mapping failed, streaming with unsynchronized maps" << std::endl;
+            glDeleteBuffers(1, &_buffer);
+            if (_state) _state->forgetBuffer(_buffer);
+            _mode = MODE_UNSYNCHRONIZED;
+            create();
+            return;
+        }
+    }
+    else
+        glBufferData(GL_ARRAY_BUFFER, total, nullptr, GL_STREAM_DRAW);
+    _frame = 0;
+    _frame_begin = _head = 0;
+}
+
+void StreamBuffer::destroy()
+{
+    if (!_buffer) return;
+    for (GLsync& fence : _fences)
+    {
+        if (fence) glDeleteSync(fence);
+        fence = 0;
+    }
+    if (_persistent)
+    {
+        bind();
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        _persistent = nullptr;
+    }
+    glDeleteBuffers(1, &_buffer);
+    if (_state) _state->forgetBuffer(_buffer);
+    _buffer = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+    if (!_buffer) return;
+    if (_overflow)
+    {
+        // regrow, GL keeps the old storage alive for draws still in flight
+        Mode mode = _mode;
+        destroy();
+        _mode = mode;
+        _frame_size *= 2;
+        _overflow = false;
+        create();
+    }
+
+    _frame = (_frame + 1) % kFrames;
+    if (_mode == MODE_ORPHAN)
+    {
+        // fresh storage every frame, the driver keeps the old one alive for the GPU
+        bind();
+        glBufferData(GL_ARRAY_BUFFER, _frame_size, nullptr, GL_STREAM_DRAW);
+        _frame_begin = _head = 0;
+        return;
+    }
+
+    GLsync& fence = _fences[_frame];
+    if (fence)
+    {
+        // normally long signalled, kFrames of latency are plenty
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while (result == GL_TIMEOUT_EXPIRED)
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    _frame_begin = _head = _frame * _frame_size;
+}
+
+void StreamBuffer::endFrame()
+{
+    if (!_buffer || _mode == MODE_ORPHAN) return;
+    if (_fences[_frame]) glDeleteSync(_fences[_frame]);
+    _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void* StreamBuffer::map(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset)
+{
+    if (!_buffer || _mapped) return nullptr;
+    // alignment need not be a power of two, ImDrawVert is 20 bytes
+    if (alignment < 1) alignment = 1;
+    GLintptr start = ((_head + alignment - 1) / alignment) * alignment;
+    if (start + size > _frame_begin + _frame_size)
+    {
+        _overflow = true;
+        return nullptr;
+    }
+    _head = start + size;
+    *offset = start;
+    if (_persistent) return _persistent + start;
+
+    // the fence (or the orphaning) already guarantees the GPU is not reading this range
+    bind();
+    void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, start, size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    _mapped = ptr != nullptr;
+    return ptr;
+}
+
+void StreamBuffer::unmap()
+{
+    if (!_mapped) return;
+    bind();
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    _mapped = false;
+}
+
+GLintptr StreamBuffer::upload(const void* data, GLsizeiptr size, GLsizeiptr alignment)
+{
+    GLintptr offset = -1;
+    void* ptr = map(size, alignment, &offset);
+    if (!ptr) return -1;
+    memcpy(ptr, data, size);
+    unmap();
+    return offset;
+}
@@ -0,0 +1,65 @@
+#ifndef _CGE_STREAM_BUFFER_H_
+#define _CGE_STREAM_BUFFER_H_
+
+#include <glad/gl.h>
+
+namespace CGE
+{
+
+class GLStateCache;
+
+// Ring buffer for per-frame vertex, index and uniform data. The buffer is split
+// into kFrames regions, each frame bump-allocates from its own region and a
+// fence guards the region until the GPU is done with it.
+//   - persistent:     glBufferStorage, mapped once, writes go straight in
+//   - unsynchronized: GL 3.2 fences, glMapBufferRange(UNSYNCHRONIZED) per upload
+//   - orphan:         no fences (plain GL 3.0), one region orphaned every frame
+// Regions that overflow are doubled at the next beginFrame().
+class StreamBuffer
+{
+public:
+    static const int kFrames = 3;
+    enum Mode { MODE_NONE, MODE_PERSISTENT, MODE_UNSYNCHRONIZED, MODE_ORPHAN };
+
+    StreamBuffer();
+    ~StreamBuffer();
+
+    // needs a current context; state, when given, is used for the buffer binds
+    bool init(GLsizeiptr frame_size, GLStateCache* state = nullptr);
+    void destroy();
+
+    // context thread, around everything that allocates in a frame
+    void beginFrame();
+    void endFrame();
+
+    // copies data into the current frame region, returns the byte offset or -1 when full
+    GLintptr upload(const void* data, GLsizeiptr size, GLsizeiptr alignment = 4);
+    // writable pointer to size bytes, must be followed by unmap() before drawing
+    void* map(GLsizeiptr size, GLsizeiptr alignment, GLintptr* offset);
+    void unmap();
+
+    GLuint buffer() const { return _buffer; }
+    Mode mode() const { return _mode; }
+    GLsizeiptr frameSize() const { return _frame_size; }
+    GLsizeiptr used() const { return _head - _frame_begin; }
+
+private:
+    void bind();
+    void create();
+
+    Mode _mode;
+    GLStateCache* _state;
+    GLuint _buffer;
+    char* _persistent;          // whole buffer mapping in persistent mode
+    GLsizeiptr _frame_size;
+    int _frame;
+    GLintptr _frame_begin;      // current region
+    GLintptr _head;             // bump pointer inside it
+    GLsync _fences[kFrames];
+    bool _mapped;
+    bool _overflow;
+};
+
+}
+
+#endif
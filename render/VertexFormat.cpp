@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "render/VertexFormat.h"
+
+using namespace CGE;
+
+QuantizationBounds::QuantizationBounds()
+{
+    for (int k = 0; k < 3; k++)
+    {
+        offset[k] = 0.0f;
+        scale[k] = 1.0f;
+    }
+}
+
+void QuantizationBounds::apply(GLuint program) const
+{
+    glUniform3fv(glGetUniformLocation(program, "u_pos_offset"), 1, offset);
+    glUniform3fv(glGetUniformLocation(program, "u_pos_scale"), 1, scale);
+}
+
+VertexFormat::VertexFormat(unsigned compression, bool color, bool normal): _compression(compression), _stride(0)
+{
+    memset(_attributes, 0, sizeof(_attributes));
+    // 4 byte aligned attributes, the quantized position pads to 8
+    auto add = [this](VertexSemantic semantic, GLint components, GLenum type, GLboolean normalized, size_t size)
+    {
+        VertexAttribute& attribute = _attributes[semantic];
+        attribute.components = components;
+        attribute.type = type;
+        attribute.normalized = normalized;
+        attribute.offset = _stride;
+        _stride += size;
+    };
+    if (compression & VC_POSITION_QUANTIZED) add(VS_POSITION, 3, GL_UNSIGNED_SHORT, GL_TRUE, 8);
+    else add(VS_POSITION, 3, GL_FLOAT, GL_FALSE, 12);
+    if (color)
+    {
+        if (compression & VC_COLOR_RGBA8) add(VS_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4);
+        else add(VS_COLOR, 4, GL_FLOAT, GL_FALSE, 16);
+    }
+    if (compression & VC_UV_HALF) add(VS_UV, 2, GL_HALF_FLOAT, GL_FALSE, 4);
+    else add(VS_UV, 2, GL_FLOAT, GL_FALSE, 8);
+    if (normal)
+    {
+        if (compression & VC_NORMAL_OCT) add(VS_NORMAL, 2, GL_SHORT, GL_TRUE, 4);
+        else add(VS_NORMAL, 3, GL_FLOAT, GL_FALSE, 12);
+    }
+}
+
+std::vector<std::string> VertexFormat::shaderDefines() const
+{
+    std::vector<std::string> defines;
+    if (_compression & VC_POSITION_QUANTIZED) defines.push_back("QUANTIZED_POSITION");
+    // only a format with normals stores them octahedral
+    if ((_compression & VC_NORMAL_OCT) && _attributes[VS_NORMAL].components == 2) defines.push_back("OCT_NORMAL");
+    return defines;
+}
+
+void VertexFormat::bind(size_t base_offset) const
+{
+    for (int semantic = 0; semantic < VS_COUNT; semantic++)
+    {
+        const VertexAttribute& attribute = _attributes[semantic];
+        if (!attribute.components)
+        {
+            glDisableVertexAttribArray(semantic);
+            continue;
+        }
+        glEnableVertexAttribArray(semantic);
+        glVertexAttribPointer(semantic, attribute.components, attribute.type, attribute.normalized, (GLsizei)_stride,
+            (const void*)(base_offset + attribute.offset));
+    }
+}
+
+uint16_t VertexFormat::floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);     // inf, nan
+    int e = (int)exponent - 127 + 15;
+    if (e >= 31) return sign | 0x7c00;
+    if (e <= 0)
+    {
+        // denormal or zero
+        if (e < -10) return sign;
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - e);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) half++;
+        return sign | (uint16_t)half;
+    }
+    uint16_t half = sign | (uint16_t)(e << 10) | (uint16_t)(mantissa >> 13);
+    // round to nearest, a carry into the exponent is still correct
+    if (mantissa & 0x1000) half++;
+    return half;
+}
+
+float VertexFormat::halfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        float f = std::ldexp((float)mantissa, -24);
+        return sign ? -f : f;
+    }
+    if (exponent == 31) bits = sign | 0x7f800000 | (mantissa << 13);
+    else bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    float f;
+    memcpy(&f, &bits, 4);
+    return f;
+}
+
+void VertexFormat::octEncode(const float normal[3], float out[2])
+{
+    float l1 = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    if (l1 == 0.0f)
+    {
+        out[0] = out[1] = 0.0f;
+        return;
+    }
+    float x = normal[0] / l1, y = normal[1] / l1;
+    if (normal[2] < 0.0f)
+    {
+        // fold the lower hemisphere over the diagonals
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = x;
+    out[1] = y;
+}
+
+void VertexFormat::octDecode(const float oct[2], float out[3])
+{
+    float x = oct[0], y = oct[1], z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = std::sqrt(x * x + y * y + z * z);
+    out[0] = x / length;
+    out[1] = y / length;
+    out[2] = z / length;
+}
+
+static int16_t snorm16(float value)
+{
+    return (int16_t)std::lround(std::min(1.0f, std::max(-1.0f, value)) * 32767.0f);
+}
+
+static uint8_t unorm8(float value)
+{
+    return (uint8_t)std::lround(std::min(1.0f, std::max(0.0f, value)) * 255.0f);
+}
+
+std::vector<uint8_t> VertexFormat::pack(const VertexStreams& streams, QuantizationBounds* bounds) const
+{
+    std::vector<uint8_t> out(streams.count * _stride, 0);
+
+    QuantizationBounds quantization;
+    if ((_compression & VC_POSITION_QUANTIZED) && streams.count)
+    {
+        float lo[3], hi[3];
+        for (int k = 0; k < 3; k++) lo[k] = hi[k] = streams.position.data[k];
+        for (size_t v = 1; v < streams.count; v++)
+        {
+            const float* p = streams.position.data + v * streams.position.stride;
+            for (int k = 0; k < 3; k++)
+            {
+                lo[k] = std::min(lo[k], p[k]);
+                hi[k] = std::max(hi[k], p[k]);
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            quantization.offset[k] = lo[k];
+            // the shader gets q in [0, 1], flat axes keep a non-zero scale
+            quantization.scale[k] = hi[k] > lo[k] ? hi[k] - lo[k] : 1.0f;
+        }
+    }
+    if (bounds) *bounds = quantization;
+
+    auto source = [](const VertexSource& s, size_t v) { return s.data ? s.data + v * s.stride : nullptr; };
+    static const float kWhite[4] = { 1, 1, 1, 1 };
+    static const float kZero[3] = { 0, 0, 0 };
+    static const float kUp[3] = { 0, 0, 1 };
+    for (size_t v = 0; v < streams.count; v++)
+    {
+        uint8_t* vertex = &out[v * _stride];
+
+        const float* position = source(streams.position, v);
+        uint8_t* dst = vertex + _attributes[VS_POSITION].offset;
+        if (_compression & VC_POSITION_QUANTIZED)
+        {
+            uint16_t q[3];
+            for (int k = 0; k < 3; k++)
+            {
+                float t = (position[k] - quantization.offset[k]) / quantization.scale[k];
+                q[k] = (uint16_t)std::lround(std::min(1.0f, std::max(0.0f, t)) * 65535.0f);
+            }
+            memcpy(dst, q, sizeof(q));
+        }
+        else memcpy(dst, position, 12);
+
+        if (_attributes[VS_COLOR].components)
+        {
+            const float* color = source(streams.color, v);
+            if (!color) color = kWhite;
+            dst = vertex + _attributes[VS_COLOR].offset;
+            if (_compression & VC_COLOR_RGBA8)
+            {
+                for (int k = 0; k < 4; k++) dst[k] = unorm8(color[k]);
+            }
+            else memcpy(dst, color, 16);
+        }
+
+        const float* uv = source(streams.uv, v);
+        if (!uv) uv = kZero;
+        dst = vertex + _attributes[VS_UV].offset;
+        if (_compression & VC_UV_HALF)
+        {
+            uint16_t h[2] = { floatToHalf(uv[0]), floatToHalf(uv[1]) };
+            memcpy(dst, h, sizeof(h));
+        }
+        else memcpy(dst, uv, 8);
+
+        if (_attributes[VS_NORMAL].components)
+        {
+            const float* normal = source(streams.normal, v);
+            if (!normal) normal = kUp;
+            dst = vertex + _attributes[VS_NORMAL].offset;
+            if (_compression & VC_NORMAL_OCT)
+            {
+                float oct[2];
+                octEncode(normal, oct);
+                int16_t s[2] = { snorm16(oct[0]), snorm16(oct[1]) };
+                memcpy(dst, s, sizeof(s));
+            }
+            else memcpy(dst, normal, 12);
+        }
+    }
+    return out;
+}
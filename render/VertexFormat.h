@@ -0,0 +1,105 @@
+#ifndef _CGE_VERTEX_FORMAT_H_
+#define _CGE_VERTEX_FORMAT_H_
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CGE
+{
+
+// Attribute locations of the lit and unlit shaders.
+enum VertexSemantic
+{
+    VS_POSITION = 0,
+    VS_COLOR,
+    VS_UV,
+    VS_NORMAL,
+    VS_COUNT
+};
+
+// Per attribute compression, any combination. GL expands half floats and
+// normalized integers by itself; quantized positions need the QUANTIZED_POSITION
+// keyword of lit (or Unlit_packed), octahedral normals OCT_NORMAL, see shaderDefines().
+enum VertexCompression
+{
+    VC_NONE = 0,
+    VC_POSITION_QUANTIZED = 1 << 0,     // unorm16 x3 against the mesh bounds, 8 bytes
+    VC_UV_HALF = 1 << 1,                // half x2, 4 bytes
+    VC_NORMAL_OCT = 1 << 2,             // octahedral snorm16 x2, 4 bytes
+    VC_COLOR_RGBA8 = 1 << 3,            // unorm8 x4, 4 bytes
+    VC_ALL = VC_POSITION_QUANTIZED | VC_UV_HALF | VC_NORMAL_OCT | VC_COLOR_RGBA8
+};
+
+struct VertexAttribute
+{
+    GLint components;       // 0 when the format has no such attribute
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// Strided float source, stride in floats, data null when the mesh lacks it.
+struct VertexSource
+{
+    const float* data;
+    size_t stride;
+};
+
+struct VertexStreams
+{
+    VertexSource position;  // xyz
+    VertexSource color;     // rgba
+    VertexSource uv;        // uv
+    VertexSource normal;    // xyz, unit length
+    size_t count;
+};
+
+// Maps quantized positions back to object space: pos = offset + q * scale.
+// Identity for float positions, so one uniform pair works for every format.
+struct QuantizationBounds
+{
+    float offset[3];
+    float scale[3];
+
+    QuantizationBounds();
+    // sets u_pos_offset and u_pos_scale on the bound program
+    void apply(GLuint program) const;
+};
+
+// Interleaved vertex layout, 48 bytes uncompressed and 20 with VC_ALL.
+class VertexFormat
+{
+public:
+    explicit VertexFormat(unsigned compression = VC_NONE, bool color = true, bool normal = true);
+
+    unsigned compression() const { return _compression; }
+    size_t stride() const { return _stride; }
+    const VertexAttribute& attribute(VertexSemantic semantic) const { return _attributes[semantic]; }
+
+    // lit keywords that decode this format, for Shader::Find
+    std::vector<std::string> shaderDefines() const;
+
+    // attribute pointers for the bound VAO and GL_ARRAY_BUFFER
+    void bind(size_t base_offset = 0) const;
+
+    // encodes count vertices into stride() bytes each; bounds gets the dequantisation
+    std::vector<uint8_t> pack(const VertexStreams& streams, QuantizationBounds* bounds = nullptr) const;
+
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t value);
+    // unit vector to octahedral [-1, 1]^2 and back
+    static void octEncode(const float normal[3], float out[2]);
+    static void octDecode(const float oct[2], float out[3]);
+
+private:
+    unsigned _compression;
+    size_t _stride;
+    VertexAttribute _attributes[VS_COUNT];
+};
+
+}
+
+#endif
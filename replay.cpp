@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "render/GLCapture.h"
+#include <GLFW/glfw3.h>
+
+using namespace CGE;
+
+// Replays a capture written by GamEng --gl-capture as fast as the driver takes
+// it and reports the per-frame CPU time, for comparing backends and drivers
+// on the exact same command stream.
+
+static void glfw_error_callback(int error, const char* description)
+{
+    std::cout << "GLFW Error" << error << ":" << description << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string path, csv;
+    bool headless = false, finish = false;
+    int loops = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--headless"))
+            headless = true;
+        else if (!strcmp(argv[i], "--finish"))
+            finish = true;
+        else if (!strcmp(argv[i], "--loops") && i + 1 < argc)
+            loops = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc)
+            csv = argv[++i];
+        else if (path.empty() && argv[i][0] != '-')
+            path = argv[i];
+        else
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+    }
+    if (path.empty())
+    {
+        std::cout << "GamEngReplay FILE [--headless] [--finish] [--loops N] [--csv FILE]" << std::endl;
+        return 1;
+    }
+
+    glfwSetErrorCallback(glfw_error_callback);
+    if (!glfwInit()) return 1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (headless) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+
+    std::vector<double> times;
+    std::vector<GLReplayFrame> frames;
+    for (int loop = 0; loop < loops; loop++)
+    {
+        GLReplay replay;
+        if (!replay.open(path))
+        {
+            std::cout << "Cannot open " << path << std::endl;
+            glfwTerminate();
+            return 1;
+        }
+        // a fresh context per loop, the stream creates every object it uses
+        GLFWwindow* window = glfwCreateWindow(replay.width(), replay.height(), "GamEng Replay", nullptr, nullptr);
+        if (window == nullptr)
+        {
+            glfwTerminate();
+            return 1;
+        }
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGL(glfwGetProcAddress))
+        {
+            std::cout << "Failed to load OpenGL functions" << std::endl;
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return 1;
+        }
+        glfwSwapInterval(0);
+
+        for (;;)
+        {
+            GLReplayFrame stats;
+            auto start = std::chrono::steady_clock::now();
+            bool more = replay.replayFrame(&stats);
+            if (!more) break;
+            if (finish) glFinish();
+            glfwSwapBuffers(window);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            frames.push_back(stats);
+        }
+        glfwDestroyWindow(window);
+    }
+    glfwTerminate();
+
+    if (times.empty())
+    {
+        std::cout << path << ": no frames" << std::endl;
+        return 1;
+    }
+    if (!csv.empty())
+    {
+        if (FILE* file = fopen(csv.c_str(), "w"))
+        {
+            fprintf(file, "frame,ms,calls,upload_bytes\n");
+            for (size_t i = 0; i < times.size(); i++)
+                fprintf(file, "%zu,%.4f,%u,%llu\n", i, times[i], frames[i].calls, (unsigned long long)frames[i].bytes);
+            fclose(file);
+        }
+        else
+            std::cout << "Cannot write " << csv << std::endl;
+    }
+
+    // the first frame creates every object, report it apart from the steady state
+    std::vector<double> sorted(times.begin(), times.end());
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double t : times) total += t;
+    printf("%zu frames in %.2f ms, first %.3f ms\n", times.size(), total, times[0]);
+    printf("frame ms avg %.3f min %.3f median %.3f p95 %.3f max %.3f\n", total / times.size(),
+        sorted.front(), sorted[sorted.size() / 2], sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)],
+        sorted.back());
+    return 0;
+}
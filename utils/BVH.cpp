@@ -0,0 +1,680 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGE_BVH_SSE
+#endif
+
+#include "utils/BVH.h"
+
+using namespace CGE_UTIL;
+
+static const int kBins = 16;
+static const uint32_t kMaxLeaf = 8;     // SAH may stop earlier
+static const float kTraversalCost = 1.0f; // node visit relative to a triangle test
+static const uint32_t kMinSubtree = 4096;
+static const int kStackSize = 64;
+
+struct Bounds
+{
+    float min[3], max[3];
+
+    Bounds() { reset(); }
+    void reset()
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            min[i] = FLT_MAX;
+            max[i] = -FLT_MAX;
+        }
+    }
+    void grow(const float* lo, const float* hi)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            min[i] = std::min(min[i], lo[i]);
+            max[i] = std::max(max[i], hi[i]);
+        }
+    }
+    float area() const
+    {
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return dx < 0 ? 0 : 2 * (dx * dy + dy * dz + dz * dx);
+    }
+};
+
+struct BVH::BuildData
+{
+    std::vector<float> lo, hi, centroid;    // 3 floats per mesh face
+    std::vector<uint32_t> order;            // faces, partitioned in place
+};
+
+BVH::BVH()
+{
+    _stats.nodes = _stats.leaves = 0;
+    _stats.depth = 0;
+    _stats.build_ms = 0;
+}
+
+void BVH::setBounds(const BuildData& data, Node& node, uint32_t first, uint32_t count) const
+{
+    Bounds b;
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        uint32_t f = data.order[i];
+        b.grow(&data.lo[f * 3], &data.hi[f * 3]);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        node.min[i] = b.min[i];
+        node.max[i] = b.max[i];
+    }
+}
+
+bool BVH::split(BuildData& data, uint32_t first, uint32_t count, uint32_t& mid) const
+{
+    if (count <= 2) return false;
+    Bounds centroids, parent;
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        uint32_t f = data.order[i];
+        centroids.grow(&data.centroid[f * 3], &data.centroid[f * 3]);
+        parent.grow(&data.lo[f * 3], &data.hi[f * 3]);
+    }
+
+    // binned SAH, cost relative to intersecting every triangle of a leaf
+    // small nodes get fewer bins, the sweeps dominate there
+    const int bin_count = (int)std::min<uint32_t>(kBins, std::max<uint32_t>(4, count));
+    float best_cost = FLT_MAX;
+    int best_axis = -1, best_bin = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float extent = centroids.max[axis] - centroids.min[axis];
+        if (extent <= 0) continue;
+        float scale = bin_count / extent;
+        Bounds bins[kBins];
+        uint32_t counts[kBins] = { 0 };
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            uint32_t f = data.order[i];
+            int b = std::min(bin_count - 1, (int)((data.centroid[f * 3 + axis] - centroids.min[axis]) * scale));
+            counts[b]++;
+            bins[b].grow(&data.lo[f * 3], &data.hi[f * 3]);
+        }
+        // sweep from the right, then from the left
+        float right_area[kBins];
+        uint32_t right_count[kBins];
+        Bounds acc;
+        uint32_t n = 0;
+        for (int b = bin_count - 1; b > 0; b--)
+        {
+            acc.grow(bins[b].min, bins[b].max);
+            n += counts[b];
+            right_area[b] = acc.area();
+            right_count[b] = n;
+        }
+        acc.reset();
+        n = 0;
+        for (int b = 0; b < bin_count - 1; b++)
+        {
+            acc.grow(bins[b].min, bins[b].max);
+            n += counts[b];
+            if (n == 0 || right_count[b + 1] == 0) continue;
+            float cost = acc.area() * n + right_area[b + 1] * right_count[b + 1];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+    if (best_axis < 0) return false;    // all centroids in one point
+
+    float parent_area = parent.area();
+    float leaf_cost = (float)count;
+    best_cost = parent_area > 0 ? kTraversalCost + best_cost / parent_area : leaf_cost;
+    if (count <= kMaxLeaf && best_cost >= leaf_cost) return false;
+
+    float lo = centroids.min[best_axis];
+    float scale = bin_count / (centroids.max[best_axis] - lo);
+    uint32_t* begin = &data.order[first];
+    uint32_t* middle = std::partition(begin, begin + count, [&](uint32_t f)
+    {
+        return std::min(bin_count - 1, (int)((data.centroid[f * 3 + best_axis] - lo) * scale)) <= best_bin;
+    });
+    mid = first + (uint32_t)(middle - begin);
+    if (mid == first || mid == first + count)
+    {
+        // float rounding put everything on one side, fall back to a median split
+        mid = first + count / 2;
+        std::nth_element(begin, begin + count / 2, begin + count, [&](uint32_t a, uint32_t b)
+        {
+            return data.centroid[a * 3 + best_axis] < data.centroid[b * 3 + best_axis];
+        });
+    }
+    return true;
+}
+
+void BVH::buildRecursive(BuildData& data, std::vector<Node>& nodes, uint32_t node, uint32_t first, uint32_t count, int depth, int& max_depth) const
+{
+    setBounds(data, nodes[node], first, count);
+    max_depth = std::max(max_depth, depth);
+    uint32_t mid;
+    if (depth >= kStackSize - 2 || !split(data, first, count, mid))
+    {
+        nodes[node].first = first;
+        nodes[node].count = count;
+        return;
+    }
+    uint32_t left = (uint32_t)nodes.size();
+    nodes[node].first = left;
+    nodes[node].count = 0;
+    nodes.resize(nodes.size() + 2);
+    buildRecursive(data, nodes, left, first, mid - first, depth + 1, max_depth);
+    buildRecursive(data, nodes, left + 1, mid, first + count - mid, depth + 1, max_depth);
+}
+
+void BVH::build(const IndexedTriangleMesh& mesh, ThreadPool* pool)
+{
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<Eigen::Vector3d>& points = mesh.points();
+    const std::vector<Eigen::Vector3i>& faces = mesh.faces();
+    uint32_t count = (uint32_t)faces.size();
+    _nodes.clear();
+    _triangles.clear();
+    _faces.clear();
+    _stats.nodes = _stats.leaves = 0;
+    _stats.depth = 0;
+    if (count == 0) return;
+
+    BuildData data;
+    data.lo.resize(count * 3);
+    data.hi.resize(count * 3);
+    data.centroid.resize(count * 3);
+    data.order.resize(count);
+    auto prepare = [&](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; f++)
+        {
+            const Eigen::Vector3i& face = faces[f];
+            for (int i = 0; i < 3; i++)
+            {
+                float a = (float)points[face[0]][i], b = (float)points[face[1]][i], c = (float)points[face[2]][i];
+                data.lo[f * 3 + i] = std::min(a, std::min(b, c));
+                data.hi[f * 3 + i] = std::max(a, std::max(b, c));
+                data.centroid[f * 3 + i] = (data.lo[f * 3 + i] + data.hi[f * 3 + i]) * 0.5f;
+            }
+            data.order[f] = (uint32_t)f;
+        }
+    };
+    if (pool) pool->parallelFor(count, 16384, prepare);
+    else prepare(0, count);
+
+    _nodes.reserve(count * 2 / 3 + 1);
+    _nodes.resize(1);
+    int max_depth = 0;
+    if (!pool || pool->size() == 1 || count < kMinSubtree * 2)
+        buildRecursive(data, _nodes, 0, 0, count, 0, max_depth);
+    else
+    {
+        // split the biggest pending range until every thread has a few subtrees
+        std::vector<Task> tasks(1);
+        tasks[0].node = 0;
+        tasks[0].first = 0;
+        tasks[0].count = count;
+        tasks[0].depth = 0;
+        std::vector<Task> ready;
+        while (!tasks.empty() && tasks.size() + ready.size() < pool->size() * 4)
+        {
+            auto biggest = std::max_element(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) { return a.count < b.count; });
+            Task task = *biggest;
+            tasks.erase(biggest);
+            Node& node = _nodes[task.node];
+            setBounds(data, node, task.first, task.count);
+            max_depth = std::max(max_depth, task.depth);
+            uint32_t mid;
+            if (task.count < kMinSubtree || !split(data, task.first, task.count, mid))
+            {
+                ready.push_back(task);
+                continue;
+            }
+            uint32_t left = (uint32_t)_nodes.size();
+            _nodes[task.node].first = left;
+            _nodes[task.node].count = 0;
+            _nodes.resize(_nodes.size() + 2);
+            Task l = { left, task.first, mid - task.first, task.depth + 1 };
+            Task r = { left + 1, mid, task.first + task.count - mid, task.depth + 1 };
+            tasks.push_back(l);
+            tasks.push_back(r);
+        }
+        tasks.insert(tasks.end(), ready.begin(), ready.end());
+
+        // subtrees touch disjoint ranges of data.order, each builds into its own nodes
+        std::vector<std::vector<Node>> subtrees(tasks.size());
+        std::vector<int> depths(tasks.size(), 0);
+        pool->parallelFor(tasks.size(), 1, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                subtrees[i].resize(1);
+                buildRecursive(data, subtrees[i], 0, tasks[i].first, tasks[i].count, tasks[i].depth, depths[i]);
+            }
+        });
+
+        // the subtree root replaces the task node, the rest is appended with rebased children
+        for (size_t i = 0; i < tasks.size(); i++)
+        {
+            const std::vector<Node>& sub = subtrees[i];
+            uint32_t base = (uint32_t)_nodes.size() - 1;
+            for (size_t n = 0; n < sub.size(); n++)
+            {
+                Node node = sub[n];
+                if (node.count == 0) node.first += base;
+                if (n == 0) _nodes[tasks[i].node] = node;
+                else _nodes.push_back(node);
+            }
+            max_depth = std::max(max_depth, depths[i]);
+        }
+    }
+
+    _faces = data.order;
+    loadTriangles(mesh, pool);
+    _stats.nodes = _nodes.size();
+    for (const Node& node : _nodes)
+        if (node.count) _stats.leaves++;
+    _stats.depth = max_depth;
+    _stats.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BVH::loadTriangles(const IndexedTriangleMesh& mesh, ThreadPool* pool)
+{
+    const std::vector<Eigen::Vector3d>& points = mesh.points();
+    const std::vector<Eigen::Vector3i>& faces = mesh.faces();
+    _triangles.resize(_faces.size());
+    auto load = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const Eigen::Vector3i& face = faces[_faces[i]];
+            Triangle& tri = _triangles[i];
+            for (int k = 0; k < 3; k++)
+            {
+                tri.v0[k] = (float)points[face[0]][k];
+                tri.e1[k] = (float)points[face[1]][k] - tri.v0[k];
+                tri.e2[k] = (float)points[face[2]][k] - tri.v0[k];
+            }
+        }
+    };
+    if (pool) pool->parallelFor(_faces.size(), 16384, load);
+    else load(0, _faces.size());
+}
+
+void BVH::refit(const IndexedTriangleMesh& mesh, ThreadPool* pool)
+{
+    if (_nodes.empty()) return;
+    loadTriangles(mesh, pool);
+    // children always come after their parent, so one backwards pass is bottom up
+    for (size_t n = _nodes.size(); n-- > 0;)
+    {
+        Node& node = _nodes[n];
+        Bounds b;
+        if (node.count)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                const Triangle& tri = _triangles[i];
+                float p1[3], p2[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p1[k] = tri.v0[k] + tri.e1[k];
+                    p2[k] = tri.v0[k] + tri.e2[k];
+                }
+                b.grow(tri.v0, tri.v0);
+                b.grow(p1, p1);
+                b.grow(p2, p2);
+            }
+        }
+        else
+        {
+            b.grow(_nodes[node.first].min, _nodes[node.first].max);
+            b.grow(_nodes[node.first + 1].min, _nodes[node.first + 1].max);
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            node.min[k] = b.min[k];
+            node.max[k] = b.max[k];
+        }
+    }
+}
+
+// Moller-Trumbore
+bool BVH::intersect(const Triangle& tri, const Ray& ray, float tmax, float& t, float& u, float& v) const
+{
+    const float* d = ray.direction.data();
+    float p[3] = { d[1] * tri.e2[2] - d[2] * tri.e2[1], d[2] * tri.e2[0] - d[0] * tri.e2[2], d[0] * tri.e2[1] - d[1] * tri.e2[0] };
+    float det = tri.e1[0] * p[0] + tri.e1[1] * p[1] + tri.e1[2] * p[2];
+    if (std::fabs(det) < 1e-12f) return false;
+    float inv = 1.0f / det;
+    float s[3] = { ray.origin[0] - tri.v0[0], ray.origin[1] - tri.v0[1], ray.origin[2] - tri.v0[2] };
+    u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+    if (u < 0 || u > 1) return false;
+    float q[3] = { s[1] * tri.e1[2] - s[2] * tri.e1[1], s[2] * tri.e1[0] - s[0] * tri.e1[2], s[0] * tri.e1[1] - s[1] * tri.e1[0] };
+    v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+    if (v < 0 || u + v > 1) return false;
+    t = (tri.e2[0] * q[0] + tri.e2[1] * q[1] + tri.e2[2] * q[2]) * inv;
+    return t > 0 && t < tmax;
+}
+
+// slab test, returns the entry distance or FLT_MAX on a miss
+static inline float rayBox(const float* min, const float* max, const float* origin, const float* inv, float tmax)
+{
+    float tnear = 0, tfar = tmax;
+    for (int i = 0; i < 3; i++)
+    {
+        float t1 = (min[i] - origin[i]) * inv[i];
+        float t2 = (max[i] - origin[i]) * inv[i];
+        tnear = std::max(tnear, std::min(t1, t2));
+        tfar = std::min(tfar, std::max(t1, t2));
+    }
+    return tnear <= tfar ? tnear : FLT_MAX;
+}
+
+bool BVH::raycast(const Ray& ray, RayHit& hit) const
+{
+    hit = RayHit();
+    if (_nodes.empty()) return false;
+    const float inv[3] = { 1.0f / ray.direction[0], 1.0f / ray.direction[1], 1.0f / ray.direction[2] };
+    float tmax = ray.tmax;
+    if (rayBox(_nodes[0].min, _nodes[0].max, ray.origin.data(), inv, tmax) == FLT_MAX) return false;
+
+    uint32_t stack[kStackSize];
+    int top = 0;
+    uint32_t node = 0;
+    while (true)
+    {
+        const Node& n = _nodes[node];
+        if (n.count)
+        {
+            for (uint32_t i = n.first; i < n.first + n.count; i++)
+            {
+                float t, u, v;
+                if (intersect(_triangles[i], ray, tmax, t, u, v))
+                {
+                    tmax = t;
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.face = _faces[i];
+                }
+            }
+        }
+        else
+        {
+            // nearer child first, the other one waits on the stack
+            uint32_t a = n.first, b = n.first + 1;
+            float ta = rayBox(_nodes[a].min, _nodes[a].max, ray.origin.data(), inv, tmax);
+            float tb = rayBox(_nodes[b].min, _nodes[b].max, ray.origin.data(), inv, tmax);
+            if (ta > tb)
+            {
+                std::swap(a, b);
+                std::swap(ta, tb);
+            }
+            if (ta != FLT_MAX)
+            {
+                if (tb != FLT_MAX) stack[top++] = b;
+                node = a;
+                continue;
+            }
+        }
+        // pop, skipping subtrees a closer hit has made pointless
+        bool found = false;
+        while (top > 0 && !found)
+        {
+            node = stack[--top];
+            found = rayBox(_nodes[node].min, _nodes[node].max, ray.origin.data(), inv, tmax) != FLT_MAX;
+        }
+        if (!found) break;
+    }
+    return hit.valid();
+}
+
+bool BVH::occluded(const Ray& ray) const
+{
+    if (_nodes.empty()) return false;
+    const float inv[3] = { 1.0f / ray.direction[0], 1.0f / ray.direction[1], 1.0f / ray.direction[2] };
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& n = _nodes[stack[--top]];
+        if (rayBox(n.min, n.max, ray.origin.data(), inv, ray.tmax) == FLT_MAX) continue;
+        if (n.count)
+        {
+            for (uint32_t i = n.first; i < n.first + n.count; i++)
+            {
+                float t, u, v;
+                if (intersect(_triangles[i], ray, ray.tmax, t, u, v)) return true;
+            }
+        }
+        else
+        {
+            stack[top++] = n.first + 1;
+            stack[top++] = n.first;
+        }
+    }
+    return false;
+}
+
+// the rays of a packet in SoA form
+struct Packet
+{
+    float origin[3][BVH::kPacket];
+    float inv[3][BVH::kPacket];
+    float tmax[BVH::kPacket];
+};
+
+// bit i set when ray i enters the box before its current tmax, tnear gets the closest entry
+static inline unsigned packetBox(const float* min, const float* max, const Packet& p, unsigned active, float& tnear)
+{
+#ifdef CGE_BVH_SSE
+    __m128 lo = _mm_setzero_ps(), hi = _mm_loadu_ps(p.tmax);
+    for (int i = 0; i < 3; i++)
+    {
+        __m128 o = _mm_loadu_ps(p.origin[i]), inv = _mm_loadu_ps(p.inv[i]);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(min[i]), o), inv);
+        __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(max[i]), o), inv);
+        lo = _mm_max_ps(lo, _mm_min_ps(t1, t2));
+        hi = _mm_min_ps(hi, _mm_max_ps(t1, t2));
+    }
+    unsigned mask = (unsigned)_mm_movemask_ps(_mm_cmple_ps(lo, hi)) & active;
+    float near_t[BVH::kPacket];
+    _mm_storeu_ps(near_t, lo);
+#else
+    unsigned mask = 0;
+    float near_t[BVH::kPacket];
+    for (int r = 0; r < BVH::kPacket; r++)
+    {
+        float lo = 0, hi = p.tmax[r];
+        for (int i = 0; i < 3; i++)
+        {
+            float t1 = (min[i] - p.origin[i][r]) * p.inv[i][r];
+            float t2 = (max[i] - p.origin[i][r]) * p.inv[i][r];
+            lo = std::max(lo, std::min(t1, t2));
+            hi = std::min(hi, std::max(t1, t2));
+        }
+        near_t[r] = lo;
+        if (lo <= hi) mask |= 1u << r;
+    }
+    mask &= active;
+#endif
+    tnear = FLT_MAX;
+    for (int r = 0; r < BVH::kPacket; r++)
+        if (mask & (1u << r)) tnear = std::min(tnear, near_t[r]);
+    return mask;
+}
+
+int BVH::raycastPacket(const Ray* rays, RayHit* hits) const
+{
+    Packet p;
+    for (int r = 0; r < kPacket; r++)
+    {
+        hits[r] = RayHit();
+        for (int i = 0; i < 3; i++)
+        {
+            p.origin[i][r] = rays[r].origin[i];
+            p.inv[i][r] = 1.0f / rays[r].direction[i];
+        }
+        p.tmax[r] = rays[r].tmax;
+    }
+    if (_nodes.empty()) return 0;
+    const unsigned all = (1u << kPacket) - 1;
+
+    // the packet shares one traversal, each node remembers which rays entered it
+    uint32_t stack[kStackSize];
+    unsigned stack_mask[kStackSize];
+    int top = 0;
+    float tnear;
+    unsigned mask = packetBox(_nodes[0].min, _nodes[0].max, p, all, tnear);
+    if (mask)
+    {
+        stack[top] = 0;
+        stack_mask[top++] = mask;
+    }
+    while (top > 0)
+    {
+        uint32_t node = stack[--top];
+        // rays may have found closer hits since the node was pushed
+        mask = packetBox(_nodes[node].min, _nodes[node].max, p, stack_mask[top], tnear);
+        if (!mask) continue;
+        const Node& n = _nodes[node];
+        if (n.count)
+        {
+            for (uint32_t i = n.first; i < n.first + n.count; i++)
+                for (int r = 0; r < kPacket; r++)
+                {
+                    float t, u, v;
+                    if ((mask & (1u << r)) && intersect(_triangles[i], rays[r], p.tmax[r], t, u, v))
+                    {
+                        p.tmax[r] = t;
+                        hits[r].t = t;
+                        hits[r].u = u;
+                        hits[r].v = v;
+                        hits[r].face = _faces[i];
+                    }
+                }
+            continue;
+        }
+        float ta, tb;
+        unsigned ma = packetBox(_nodes[n.first].min, _nodes[n.first].max, p, mask, ta);
+        unsigned mb = packetBox(_nodes[n.first + 1].min, _nodes[n.first + 1].max, p, mask, tb);
+        // push the farther child first so the nearer one is popped next
+        if (ta <= tb)
+        {
+            if (mb) { stack[top] = n.first + 1; stack_mask[top++] = mb; }
+            if (ma) { stack[top] = n.first; stack_mask[top++] = ma; }
+        }
+        else
+        {
+            if (ma) { stack[top] = n.first; stack_mask[top++] = ma; }
+            if (mb) { stack[top] = n.first + 1; stack_mask[top++] = mb; }
+        }
+    }
+    int count = 0;
+    for (int r = 0; r < kPacket; r++) count += hits[r].valid();
+    return count;
+}
+
+void BVH::queryAABB(const Eigen::Vector3f& min, const Eigen::Vector3f& max, std::vector<uint32_t>& faces) const
+{
+    if (_nodes.empty()) return;
+    auto overlaps = [&](const float* lo, const float* hi)
+    {
+        return lo[0] <= max[0] && hi[0] >= min[0] && lo[1] <= max[1] && hi[1] >= min[1] && lo[2] <= max[2] && hi[2] >= min[2];
+    };
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& n = _nodes[stack[--top]];
+        if (!overlaps(n.min, n.max)) continue;
+        if (n.count == 0)
+        {
+            stack[top++] = n.first + 1;
+            stack[top++] = n.first;
+            continue;
+        }
+        for (uint32_t i = n.first; i < n.first + n.count; i++)
+        {
+            const Triangle& tri = _triangles[i];
+            float lo[3], hi[3];
+            for (int k = 0; k < 3; k++)
+            {
+                lo[k] = tri.v0[k] + std::min(0.0f, std::min(tri.e1[k], tri.e2[k]));
+                hi[k] = tri.v0[k] + std::max(0.0f, std::max(tri.e1[k], tri.e2[k]));
+            }
+            if (overlaps(lo, hi)) faces.push_back(_faces[i]);
+        }
+    }
+}
+
+// closest point on triangle a, a + e1, a + e2 to p (Ericson, Real-Time Collision Detection 5.1.5)
+static Eigen::Vector3f closestPoint(const Eigen::Vector3f& p, const Eigen::Vector3f& a, const Eigen::Vector3f& e1, const Eigen::Vector3f& e2)
+{
+    Eigen::Vector3f b = a + e1, c = a + e2;
+    Eigen::Vector3f ap = p - a;
+    float d1 = e1.dot(ap), d2 = e2.dot(ap);
+    if (d1 <= 0 && d2 <= 0) return a;
+    Eigen::Vector3f bp = p - b;
+    float d3 = e1.dot(bp), d4 = e2.dot(bp);
+    if (d3 >= 0 && d4 <= d3) return b;
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + e1 * (d1 / (d1 - d3));
+    Eigen::Vector3f cp = p - c;
+    float d5 = e1.dot(cp), d6 = e2.dot(cp);
+    if (d6 >= 0 && d5 <= d6) return c;
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + e2 * (d2 / (d2 - d6));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    float denom = 1.0f / (va + vb + vc);
+    return a + e1 * (vb * denom) + e2 * (vc * denom);
+}
+
+void BVH::querySphere(const Eigen::Vector3f& center, float radius, std::vector<uint32_t>& faces) const
+{
+    if (_nodes.empty()) return;
+    const float r2 = radius * radius;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& n = _nodes[stack[--top]];
+        float d2 = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            float d = std::max(n.min[k] - center[k], std::max(0.0f, center[k] - n.max[k]));
+            d2 += d * d;
+        }
+        if (d2 > r2) continue;
+        if (n.count == 0)
+        {
+            stack[top++] = n.first + 1;
+            stack[top++] = n.first;
+            continue;
+        }
+        for (uint32_t i = n.first; i < n.first + n.count; i++)
+        {
+            const Triangle& tri = _triangles[i];
+            Eigen::Vector3f q = closestPoint(center, Eigen::Vector3f(tri.v0[0], tri.v0[1], tri.v0[2]),
+                Eigen::Vector3f(tri.e1[0], tri.e1[1], tri.e1[2]), Eigen::Vector3f(tri.e2[0], tri.e2[1], tri.e2[2]));
+            if ((q - center).squaredNorm() <= r2) faces.push_back(_faces[i]);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef _CGE_BVH_H_
+#define _CGE_BVH_H_
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils/geometry.h"
+#include "utils/ThreadPool.h"
+
+namespace CGE_UTIL
+{
+
+struct Ray
+{
+    Eigen::Vector3f origin;
+    Eigen::Vector3f direction;  // need not be normalized, t is in its units
+    float tmax;
+
+    Ray(): origin(0, 0, 0), direction(0, 0, -1), tmax(FLT_MAX) {}
+    Ray(const Eigen::Vector3f& o, const Eigen::Vector3f& d, float t = FLT_MAX): origin(o), direction(d), tmax(t) {}
+};
+
+struct RayHit
+{
+    static const uint32_t kNone = 0xffffffffu;
+
+    float t;
+    float u, v;             // barycentrics of face vertices 1 and 2
+    uint32_t face;          // index into the mesh faces, kNone on a miss
+
+    RayHit(): t(FLT_MAX), u(0), v(0), face(kNone) {}
+    bool valid() const { return face != kNone; }
+};
+
+struct BVHStats
+{
+    size_t nodes;
+    size_t leaves;
+    int depth;
+    double build_ms;
+};
+
+// Bounding volume hierarchy over the triangles of an IndexedTriangleMesh, built
+// with binned SAH. Nodes are 32 bytes with both children stored next to each
+// other, and triangles are copied in leaf order as (v0, e1, e2) floats so a
+// leaf is one contiguous read. Queries are const and can run on any number of
+// threads at once.
+class BVH
+{
+public:
+    static const int kPacket = 4;
+
+    BVH();
+
+    // with a pool the top of the tree is split serially and the subtrees built in parallel
+    void build(const IndexedTriangleMesh& mesh, ThreadPool* pool = nullptr);
+    // keeps the topology, recomputes triangles and bounds after the points moved
+    void refit(const IndexedTriangleMesh& mesh, ThreadPool* pool = nullptr);
+
+    // closest hit within (0, ray.tmax)
+    bool raycast(const Ray& ray, RayHit& hit) const;
+    // any hit within (0, ray.tmax), for shadow and line of sight tests
+    bool occluded(const Ray& ray) const;
+    // kPacket rays traversed together, cheaper than one by one when they are
+    // coherent (picking regions, shadow rays to one light); returns the hit count
+    int raycastPacket(const Ray* rays, RayHit* hits) const;
+
+    // faces whose bounds overlap the box, conservative
+    void queryAABB(const Eigen::Vector3f& min, const Eigen::Vector3f& max, std::vector<uint32_t>& faces) const;
+    // faces within radius of center, exact
+    void querySphere(const Eigen::Vector3f& center, float radius, std::vector<uint32_t>& faces) const;
+
+    bool empty() const { return _nodes.empty(); }
+    const BVHStats& stats() const { return _stats; }
+
+private:
+    struct Node
+    {
+        float min[3];
+        uint32_t first;     // leaf: first triangle, interior: left child, the right one follows
+        float max[3];
+        uint32_t count;     // triangles, 0 for interior nodes
+    };
+    struct Triangle
+    {
+        float v0[3], e1[3], e2[3];
+    };
+    struct Task
+    {
+        uint32_t node;
+        uint32_t first, count;
+        int depth;
+    };
+    struct BuildData;
+
+    bool split(BuildData& data, uint32_t first, uint32_t count, uint32_t& mid) const;
+    void buildRecursive(BuildData& data, std::vector<Node>& nodes, uint32_t node, uint32_t first, uint32_t count, int depth, int& max_depth) const;
+    void setBounds(const BuildData& data, Node& node, uint32_t first, uint32_t count) const;
+    void loadTriangles(const IndexedTriangleMesh& mesh, ThreadPool* pool);
+    bool intersect(const Triangle& tri, const Ray& ray, float tmax, float& t, float& u, float& v) const;
+
+    std::vector<Node> _nodes;
+    std::vector<Triangle> _triangles;
+    std::vector<uint32_t> _faces;       // mesh face of each triangle in leaf order
+    BVHStats _stats;
+};
+
+}
+
+#endif
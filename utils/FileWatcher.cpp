@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "utils/FileWatcher.h"
+
+using namespace CGE_UTIL;
+
+FileWatcher::FileWatcher():
+    _fd(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (_fd >= 0) close(_fd);
+}
+
+#ifdef __linux__
+
+bool FileWatcher::watch(const std::string& dir)
+{
+    if (_fd < 0) _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_fd < 0) return false;
+    int wd = inotify_add_watch(_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        std::cout << "Cannot watch " << dir << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    _dirs[wd] = dir;
+
+    if (DIR* handle = opendir(dir.c_str()))
+    {
+        while (dirent* e = readdir(handle))
+            if (e->d_type == DT_DIR && strcmp(e->d_name, ".") && strcmp(e->d_name, ".."))
+                watch(dir + "/" + e->d_name);
+        closedir(handle);
+    }
+    return true;
+}
+
+bool FileWatcher::poll(std::vector<std::string>* changed)
+{
+    changed->clear();
+    if (_fd < 0) return false;
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t size = read(_fd, buffer, sizeof(buffer));
+        if (size <= 0) break;
+        for (char* p = buffer; p < buffer + size;)
+        {
+            const inotify_event* e = (const inotify_event*)p;
+            p += sizeof(inotify_event) + e->len;
+            auto dir = _dirs.find(e->wd);
+            if (dir == _dirs.end() || !e->len || (e->mask & IN_ISDIR)) continue;
+            std::string path = dir->second + "/" + e->name;
+            // a save often arrives as several events
+            if (std::find(changed->begin(), changed->end(), path) == changed->end())
+                changed->push_back(path);
+        }
+    }
+    return !changed->empty();
+}
+
+#else
+
+bool FileWatcher::watch(const std::string&)
+{
+    return false;
+}
+
+bool FileWatcher::poll(std::vector<std::string>* changed)
+{
+    changed->clear();
+    return false;
+}
+
+#endif
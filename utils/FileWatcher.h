@@ -0,0 +1,35 @@
+#ifndef _CGE_FILE_WATCHER_H_
+#define _CGE_FILE_WATCHER_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace CGE_UTIL
+{
+
+// Reports files written under a set of directories, through inotify on Linux.
+// Reacts to IN_CLOSE_WRITE and IN_MOVED_TO, so editors that save through a
+// temporary file and a rename are seen once the new file is in place.
+// Elsewhere watch() fails and nothing is ever reported.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // dir and the subdirectories it has now
+    bool watch(const std::string& dir);
+    bool active() const { return !_dirs.empty(); }
+
+    // never blocks: paths changed since the last call, each once
+    bool poll(std::vector<std::string>* changed);
+
+private:
+    int _fd;
+    std::unordered_map<int, std::string> _dirs;     // watch descriptor -> directory
+};
+
+}
+
+#endif
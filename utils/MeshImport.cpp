@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include "utils/MeshImport.h"
+#include "utils/MeshSimplify.h"
+
+using namespace CGE_UTIL;
+
+static void buildLods(ImportedMesh& out, const MeshImportOptions& options)
+{
+    const size_t count = out.vertexCount();
+    std::vector<Eigen::Vector3d> points(count);
+    std::vector<float> attributes(count * 5);
+    for (size_t v = 0; v < count; v++)
+    {
+        const float* vertex = &out.vertices[v * ImportedMesh::kStride];
+        points[v] = Eigen::Vector3d(vertex[0], vertex[1], vertex[2]);
+        std::copy(vertex + 3, vertex + 8, &attributes[v * 5]);
+    }
+    const std::vector<uint32_t>& indices = out.lods[0].indices;
+    std::vector<Eigen::Vector3i> faces(indices.size() / 3);
+    for (size_t f = 0; f < faces.size(); f++)
+        faces[f] = Eigen::Vector3i(indices[f * 3], indices[f * 3 + 1], indices[f * 3 + 2]);
+
+    // normals and uvs keep seams from collapsing across
+    SimplifyOptions simplify;
+    simplify.attributes = attributes.data();
+    simplify.attribute_stride = 5;
+    MeshLodChain chain = buildLodChain(IndexedTriangleMesh(points, faces), options.lod_ratios, simplify);
+    for (size_t l = 1; l < chain.levels.size(); l++)
+    {
+        ImportedLod lod;
+        lod.error = chain.levels[l].error;
+        for (const Eigen::Vector3i& face : chain.levels[l].faces)
+            for (int k = 0; k < 3; k++) lod.indices.push_back((uint32_t)face[k]);
+        // levels share the vertex order of the full mesh, only the triangles are reordered
+        optimizeVertexCache(lod.indices, count);
+        out.lods.push_back(lod);
+    }
+}
+
+bool CGE_UTIL::importMeshes(const std::string& path, std::vector<ImportedMesh>& meshes, std::string& error,
+    const MeshImportOptions& options)
+{
+    // no JoinIdenticalVertices, welding happens in the optimise stage
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+        aiProcess_SortByPType | aiProcess_FindDegenerates);
+    if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE))
+    {
+        error = importer.GetErrorString();
+        return false;
+    }
+
+    for (unsigned m = 0; m < scene->mNumMeshes; m++)
+    {
+        const aiMesh* mesh = scene->mMeshes[m];
+        if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) continue;
+
+        ImportedMesh out;
+        out.name = mesh->mName.C_Str();
+        out.vertices.resize(mesh->mNumVertices * ImportedMesh::kStride, 0.0f);
+        for (unsigned v = 0; v < mesh->mNumVertices; v++)
+        {
+            float* vertex = &out.vertices[v * ImportedMesh::kStride];
+            vertex[0] = mesh->mVertices[v].x;
+            vertex[1] = mesh->mVertices[v].y;
+            vertex[2] = mesh->mVertices[v].z;
+            if (mesh->HasNormals())
+            {
+                vertex[3] = mesh->mNormals[v].x;
+                vertex[4] = mesh->mNormals[v].y;
+                vertex[5] = mesh->mNormals[v].z;
+            }
+            if (mesh->HasTextureCoords(0))
+            {
+                vertex[6] = mesh->mTextureCoords[0][v].x;
+                vertex[7] = mesh->mTextureCoords[0][v].y;
+            }
+        }
+        out.lods.resize(1);
+        out.lods[0].error = 0;
+        std::vector<uint32_t>& indices = out.lods[0].indices;
+        indices.reserve(mesh->mNumFaces * 3);
+        for (unsigned f = 0; f < mesh->mNumFaces; f++)
+        {
+            const aiFace& face = mesh->mFaces[f];
+            if (face.mNumIndices != 3) continue;
+            indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
+        }
+
+        out.stats = optimizeMesh(out.vertices, ImportedMesh::kStride, indices, options.optimize);
+        if (!options.lod_ratios.empty()) buildLods(out, options);
+        meshes.push_back(std::move(out));
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef _CGE_MESH_IMPORT_H_
+#define _CGE_MESH_IMPORT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/MeshOptimize.h"
+
+namespace CGE_UTIL
+{
+
+struct ImportedLod
+{
+    std::vector<uint32_t> indices;
+    double error;
+};
+
+// One assimp mesh after the optimise stage. Vertices are interleaved
+// position, normal, uv; lods[0] is the full mesh, all levels share the vertices.
+struct ImportedMesh
+{
+    static const size_t kStride = 8;
+
+    std::string name;
+    std::vector<float> vertices;
+    std::vector<ImportedLod> lods;
+    MeshOptimizeStats stats;
+
+    size_t vertexCount() const { return vertices.size() / kStride; }
+};
+
+struct MeshImportOptions
+{
+    MeshOptimizeOptions optimize;
+    std::vector<double> lod_ratios;     // simplified levels to build, empty for none
+
+    MeshImportOptions(): lod_ratios({ 0.5, 0.25, 0.125 }) {}
+};
+
+// Loads every mesh of a file through assimp, triangulated, then welds and
+// reorders it for the vertex cache, overdraw and vertex fetch. Returns false
+// and fills error when assimp cannot read the file.
+bool importMeshes(const std::string& path, std::vector<ImportedMesh>& meshes, std::string& error,
+    const MeshImportOptions& options = MeshImportOptions());
+
+}
+
+#endif
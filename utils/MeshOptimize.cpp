@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "utils/MeshOptimize.h"
+
+using namespace CGE_UTIL;
+
+static const uint32_t kUnused = 0xffffffffu;
+
+size_t CGE_UTIL::weldVertices(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices, float epsilon)
+{
+    const size_t count = vertices.size() / stride;
+    std::vector<uint32_t> remap(count);
+    if (epsilon < 0)
+    {
+        for (size_t v = 0; v < count; v++) remap[v] = (uint32_t)v;
+    }
+    else
+    {
+        // cells at least epsilon wide, a match can only sit in the 27 cells around a vertex
+        const float cell = std::max(epsilon, 1e-20f) * 2.0f;
+        auto key = [](int64_t x, int64_t y, int64_t z)
+        {
+            return (uint64_t)(x * 73856093) ^ (uint64_t)(y * 19349663) ^ (uint64_t)(z * 83492791);
+        };
+        std::unordered_multimap<uint64_t, uint32_t> grid;
+        grid.reserve(count);
+        std::vector<uint32_t> kept;
+        for (size_t v = 0; v < count; v++)
+        {
+            const float* a = &vertices[v * stride];
+            int64_t cx = (int64_t)std::floor(a[0] / cell), cy = (int64_t)std::floor(a[1] / cell), cz = (int64_t)std::floor(a[2] / cell);
+            uint32_t match = kUnused;
+            for (int dz = -1; dz <= 1 && match == kUnused; dz++)
+                for (int dy = -1; dy <= 1 && match == kUnused; dy++)
+                    for (int dx = -1; dx <= 1 && match == kUnused; dx++)
+                    {
+                        auto range = grid.equal_range(key(cx + dx, cy + dy, cz + dz));
+                        for (auto it = range.first; it != range.second; ++it)
+                        {
+                            const float* b = &vertices[it->second * stride];
+                            size_t i = 0;
+                            while (i < stride && std::fabs(a[i] - b[i]) <= epsilon) i++;
+                            if (i == stride)
+                            {
+                                match = it->second;
+                                break;
+                            }
+                        }
+                    }
+            if (match == kUnused)
+            {
+                match = (uint32_t)v;
+                grid.emplace(key(cx, cy, cz), match);
+            }
+            remap[v] = match;
+        }
+    }
+    for (uint32_t& index : indices) index = remap[index];
+    // the first vertex of each group stays, compaction happens in the fetch pass
+    return optimizeVertexFetch(vertices, stride, indices);
+}
+
+VertexCacheStats CGE_UTIL::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, unsigned cache_size)
+{
+    VertexCacheStats stats = { 0, 0 };
+    if (indices.empty()) return stats;
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    std::vector<char> used(vertex_count, 0);
+    uint32_t time = cache_size + 1;
+    size_t misses = 0, referenced = 0;
+    for (uint32_t index : indices)
+    {
+        // FIFO: an entry is live while fewer than cache_size misses happened since it was loaded
+        if (time - timestamps[index] > cache_size)
+        {
+            timestamps[index] = time++;
+            misses++;
+        }
+        if (!used[index])
+        {
+            used[index] = 1;
+            referenced++;
+        }
+    }
+    stats.acmr = (double)misses / (indices.size() / 3);
+    stats.atvr = referenced ? (double)misses / referenced : 0;
+    return stats;
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+static const int kForsythCache = 32;
+
+static float vertexScore(int cache_position, int remaining)
+{
+    if (remaining == 0) return -1.0f;
+    float score = 0;
+    if (cache_position >= 0)
+    {
+        if (cache_position < 3) score = 0.75f;      // in the last triangle
+        else
+        {
+            float scaler = 1.0f / (kForsythCache - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+    // prefer vertices with few triangles left, they are cheap to finish off
+    return score + 2.0f * std::pow((float)remaining, -0.5f);
+}
+
+void CGE_UTIL::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) return;
+
+    // vertex -> triangles, compact
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (uint32_t index : indices) offsets[index + 1]++;
+    for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+    std::vector<int> remaining(vertex_count), cache_position(vertex_count, -1);
+    std::vector<float> score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+        remaining[v] = (int)(offsets[v + 1] - offsets[v]);
+        score[v] = vertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<char> emitted(triangle_count, 0);
+    for (size_t t = 0; t < triangle_count; t++)
+        triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    uint32_t cache[kForsythCache + 3];
+    int cache_count = 0;
+    size_t scan = 0;
+    uint32_t best = kUnused;
+    for (size_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+    {
+        if (best == kUnused)
+        {
+            // nothing in the cache is useful, take the best of the rest
+            float best_score = -1e30f;
+            for (size_t t = scan; t < triangle_count; t++)
+                if (!emitted[t] && triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best = (uint32_t)t;
+                }
+            while (scan < triangle_count && emitted[scan]) scan++;
+        }
+        emitted[best] = 1;
+        const uint32_t tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+        result.insert(result.end(), tri, tri + 3);
+
+        // the triangle's vertices go to the front of the LRU cache
+        uint32_t next[kForsythCache + 3];
+        int next_count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            next[next_count++] = tri[k];
+            remaining[tri[k]]--;
+            // take the triangle out of the vertex's list
+            uint32_t* begin = &adjacency[offsets[tri[k]]];
+            uint32_t* end = begin + remaining[tri[k]] + 1;
+            std::swap(*std::find(begin, end, best), *(end - 1));
+        }
+        for (int i = 0; i < cache_count; i++)
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2]) next[next_count++] = cache[i];
+        for (int i = 0; i < next_count; i++)
+        {
+            uint32_t v = next[i];
+            cache_position[v] = i < kForsythCache ? i : -1;
+            score[v] = vertexScore(cache_position[v], remaining[v]);
+        }
+        cache_count = std::min(next_count, kForsythCache);
+        for (int i = 0; i < cache_count; i++) cache[i] = next[i];
+
+        // rescore triangles around cached vertices and pick the next one from them
+        best = kUnused;
+        float best_score = -1e30f;
+        for (int i = 0; i < next_count; i++)
+        {
+            uint32_t v = next[i];
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                uint32_t t = adjacency[a];
+                float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                triangle_score[t] = s;
+                if (i < cache_count && s > best_score)
+                {
+                    best_score = s;
+                    best = t;
+                }
+            }
+        }
+    }
+    indices.swap(result);
+}
+
+void CGE_UTIL::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t stride, float threshold,
+    unsigned cache_size)
+{
+    const size_t triangle_count = indices.size() / 3;
+    const size_t vertex_count = vertices.size() / stride;
+    if (triangle_count < 2) return;
+    const VertexCacheStats input = analyzeVertexCache(indices, vertex_count, cache_size);
+
+    // clusters start where a triangle misses the cache with all three vertices
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> timestamps(vertex_count, 0);
+    uint32_t time = cache_size + 1;
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t * 3 + k];
+            if (time - timestamps[v] > cache_size)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3) clusters.push_back((uint32_t)t);
+    }
+    if (clusters.size() < 2) return;
+    clusters.push_back((uint32_t)triangle_count);
+
+    auto position = [&](uint32_t v, int k) { return vertices[v * stride + k]; };
+    double mesh_centroid[3] = { 0, 0, 0 };
+    for (size_t v = 0; v < vertex_count; v++)
+        for (int k = 0; k < 3; k++) mesh_centroid[k] += position((uint32_t)v, k);
+    for (int k = 0; k < 3; k++) mesh_centroid[k] /= std::max<size_t>(1, vertex_count);
+
+    // area weighted centroid and normal of each cluster, outward facing clusters draw first
+    struct Cluster { uint32_t begin, end; double key; };
+    std::vector<Cluster> sorted;
+    for (size_t c = 0; c + 1 < clusters.size(); c++)
+    {
+        double centroid[3] = { 0, 0, 0 }, normal[3] = { 0, 0, 0 }, area_sum = 0;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const uint32_t* tri = &indices[t * 3];
+            double e1[3], e2[3];
+            for (int k = 0; k < 3; k++)
+            {
+                e1[k] = position(tri[1], k) - position(tri[0], k);
+                e2[k] = position(tri[2], k) - position(tri[0], k);
+            }
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; k++)
+            {
+                normal[k] += n[k];
+                centroid[k] += area * (position(tri[0], k) + position(tri[1], k) + position(tri[2], k)) / 3.0;
+            }
+            area_sum += area;
+        }
+        double key = 0;
+        if (area_sum > 0)
+            for (int k = 0; k < 3; k++) key += (centroid[k] / area_sum - mesh_centroid[k]) * normal[k] / area_sum;
+        Cluster cluster = { clusters[c], clusters[c + 1], key };
+        sorted.push_back(cluster);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (const Cluster& cluster : sorted)
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    if (analyzeVertexCache(result, vertex_count, cache_size).acmr <= input.acmr * threshold)
+        indices.swap(result);
+}
+
+size_t CGE_UTIL::optimizeVertexFetch(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices)
+{
+    const size_t count = vertices.size() / stride;
+    std::vector<uint32_t> remap(count, kUnused);
+    std::vector<float> result;
+    result.reserve(vertices.size());
+    uint32_t next = 0;
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == kUnused)
+        {
+            remap[index] = next++;
+            result.insert(result.end(), vertices.begin() + index * stride, vertices.begin() + (index + 1) * stride);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+    return next;
+}
+
+MeshOptimizeStats CGE_UTIL::optimizeMesh(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices,
+    const MeshOptimizeOptions& options)
+{
+    MeshOptimizeStats stats;
+    stats.vertices_before = vertices.size() / stride;
+    stats.before = analyzeVertexCache(indices, stats.vertices_before, options.cache_size);
+
+    size_t count = weldVertices(vertices, stride, indices, options.weld_epsilon);
+    optimizeVertexCache(indices, count);
+    optimizeOverdraw(indices, vertices, stride, options.overdraw_threshold, options.cache_size);
+    count = optimizeVertexFetch(vertices, stride, indices);
+
+    stats.vertices_after = count;
+    stats.after = analyzeVertexCache(indices, count, options.cache_size);
+    return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef _CGE_MESH_OPTIMIZE_H_
+#define _CGE_MESH_OPTIMIZE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CGE_UTIL
+{
+
+// Post-transform cache behaviour of an index buffer, simulated with a FIFO cache.
+struct VertexCacheStats
+{
+    double acmr;    // vertices transformed per triangle, 0.5 is ideal for grids, 3 is no reuse
+    double atvr;    // vertices transformed per vertex, 1 is ideal
+};
+
+struct MeshOptimizeOptions
+{
+    float weld_epsilon;         // attributes closer than this are one vertex, < 0 skips welding
+    float overdraw_threshold;   // ACMR the overdraw pass may cost, as a factor of the cache optimised one
+    unsigned cache_size;        // FIFO entries for the statistics and the overdraw clusters
+
+    MeshOptimizeOptions(): weld_epsilon(1e-6f), overdraw_threshold(1.05f), cache_size(16) {}
+};
+
+struct MeshOptimizeStats
+{
+    size_t vertices_before, vertices_after;
+    VertexCacheStats before, after;
+};
+
+// Interleaved float vertices, stride floats each, the position in the first three.
+
+// merges vertices whose floats all lie within epsilon using a hash grid on the
+// position, then drops the unused ones; returns the new vertex count
+size_t weldVertices(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices, float epsilon);
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count, unsigned cache_size = 16);
+
+// Forsyth's linear-speed triangle order for post-transform cache reuse
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count);
+
+// splits a cache optimised order into clusters at cache breaks and draws the
+// outward facing ones first, so more pixels fail the depth test; reverted
+// when the ACMR for a cache_size FIFO rises above threshold times the input's
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& vertices, size_t stride,
+    float threshold = 1.05f, unsigned cache_size = 16);
+
+// reorders vertices by first use so fetches walk memory forwards, drops unused
+// ones; returns the new vertex count
+size_t optimizeVertexFetch(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices);
+
+// weld, vertex cache, overdraw and fetch order, in that order
+MeshOptimizeStats optimizeMesh(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices,
+    const MeshOptimizeOptions& options = MeshOptimizeOptions());
+
+}
+
+#endif
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+#include "utils/MeshSimplify.h"
+
+using namespace CGE_UTIL;
+
+// border planes weigh this much more than faces, so borders barely move
+static const double kBorderWeight = 10.0;
+// a collapse may turn a face by at most this much (cosine)
+static const double kMinNormalDot = 0.25;
+
+namespace
+{
+
+// symmetric 4x4 error quadric of weighted planes, plus the total weight so the
+// error can be reported as a distance
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double w;
+
+    Quadric(): a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), w(0) {}
+
+    void addPlane(const Eigen::Vector3d& n, double d, double weight)
+    {
+        a00 += weight * n[0] * n[0];
+        a01 += weight * n[0] * n[1];
+        a02 += weight * n[0] * n[2];
+        a11 += weight * n[1] * n[1];
+        a12 += weight * n[1] * n[2];
+        a22 += weight * n[2] * n[2];
+        b0 += weight * n[0] * d;
+        b1 += weight * n[1] * d;
+        b2 += weight * n[2] * d;
+        c += weight * d * d;
+        w += weight;
+    }
+    void add(const Quadric& q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        w += q.w;
+    }
+    // weighted mean squared distance to the planes
+    double error(const Eigen::Vector3d& p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        double e = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + a11 * y * y + 2 * a12 * y * z + a22 * z * z
+            + 2 * (b0 * x + b1 * y + b2 * z) + c;
+        return w > 0 ? std::max(0.0, e) / w : 0.0;
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    uint32_t from, to;
+    uint32_t stamp_from, stamp_to;
+    bool operator<(const Collapse& other) const { return cost > other.cost; }   // min heap
+};
+
+class Simplifier
+{
+public:
+    Simplifier(const std::vector<Eigen::Vector3d>& points, const std::vector<Eigen::Vector3i>& faces, const SimplifyOptions& options):
+        _points(points), _faces(faces), _options(options)
+    {
+    }
+
+    std::vector<Eigen::Vector3i> run(double* error);
+
+private:
+    bool alive(uint32_t face) const { return _faces[face][0] >= 0; }
+    void push(uint32_t a, uint32_t b);
+    bool evaluate(uint32_t from, uint32_t to, double& cost) const;
+    bool flips(uint32_t from, uint32_t to) const;
+    bool linked(uint32_t from, uint32_t to) const;
+    void ring(uint32_t v, std::vector<uint32_t>& out) const;
+    void collapse(uint32_t from, uint32_t to);
+
+    const std::vector<Eigen::Vector3d>& _points;
+    std::vector<Eigen::Vector3i> _faces;
+    const SimplifyOptions& _options;
+    std::vector<Quadric> _quadrics;
+    std::vector<std::vector<uint32_t>> _vertex_faces;
+    std::vector<uint32_t> _stamps;
+    std::vector<char> _locked;
+    std::vector<char> _removed;
+    std::priority_queue<Collapse> _heap;
+};
+
+bool Simplifier::flips(uint32_t from, uint32_t to) const
+{
+    const Eigen::Vector3d& target = _points[to];
+    for (uint32_t f : _vertex_faces[from])
+    {
+        if (!alive(f)) continue;
+        const Eigen::Vector3i& face = _faces[f];
+        if (face[0] == (int)to || face[1] == (int)to || face[2] == (int)to) continue;  // removed by the collapse
+        Eigen::Vector3d p[3], q[3];
+        for (int k = 0; k < 3; k++)
+        {
+            p[k] = _points[face[k]];
+            q[k] = face[k] == (int)from ? target : p[k];
+        }
+        Eigen::Vector3d before = (p[1] - p[0]).cross(p[2] - p[0]);
+        Eigen::Vector3d after = (q[1] - q[0]).cross(q[2] - q[0]);
+        double lb = before.norm(), la = after.norm();
+        if (la <= 1e-12 * std::max(1.0, lb)) return true;
+        if (lb > 0 && before.dot(after) < kMinNormalDot * lb * la) return true;
+    }
+    return false;
+}
+
+// neighbours of v over its live faces, sorted
+void Simplifier::ring(uint32_t v, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    for (uint32_t f : _vertex_faces[v])
+    {
+        if (!alive(f)) continue;
+        for (int k = 0; k < 3; k++)
+            if (_faces[f][k] != (int)v) out.push_back(_faces[f][k]);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Link condition: the only vertices both ends share are the ones opposite the
+// edge in its faces, two inside the mesh and one on a border. Anything else
+// would pinch the surface into a non-manifold vertex or duplicate faces.
+bool Simplifier::linked(uint32_t from, uint32_t to) const
+{
+    std::vector<uint32_t> opposite;
+    for (uint32_t f : _vertex_faces[from])
+    {
+        if (!alive(f)) continue;
+        const Eigen::Vector3i& face = _faces[f];
+        if (face[0] != (int)to && face[1] != (int)to && face[2] != (int)to) continue;
+        for (int k = 0; k < 3; k++)
+            if (face[k] != (int)from && face[k] != (int)to) opposite.push_back(face[k]);
+    }
+    if (opposite.empty()) return false;
+    std::sort(opposite.begin(), opposite.end());
+    opposite.erase(std::unique(opposite.begin(), opposite.end()), opposite.end());
+
+    std::vector<uint32_t> a, b, common;
+    ring(from, a);
+    ring(to, b);
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+    return common == opposite;
+}
+
+bool Simplifier::evaluate(uint32_t from, uint32_t to, double& cost) const
+{
+    if (_locked[from]) return false;
+    Quadric q = _quadrics[from];
+    q.add(_quadrics[to]);
+    cost = q.error(_points[to]);
+    if (_options.attributes && _options.attribute_stride)
+    {
+        const float* a = _options.attributes + from * _options.attribute_stride;
+        const float* b = _options.attributes + to * _options.attribute_stride;
+        double d2 = 0;
+        for (size_t i = 0; i < _options.attribute_stride; i++) d2 += (double)(a[i] - b[i]) * (a[i] - b[i]);
+        cost += _options.attribute_weight * d2;
+    }
+    return true;
+}
+
+void Simplifier::push(uint32_t a, uint32_t b)
+{
+    // the cheaper direction of the edge
+    double ab, ba;
+    bool can_ab = evaluate(a, b, ab), can_ba = evaluate(b, a, ba);
+    if (!can_ab && !can_ba) return;
+    Collapse c;
+    if (can_ab && (!can_ba || ab <= ba))
+    {
+        c.cost = ab;
+        c.from = a;
+        c.to = b;
+    }
+    else
+    {
+        c.cost = ba;
+        c.from = b;
+        c.to = a;
+    }
+    c.stamp_from = _stamps[c.from];
+    c.stamp_to = _stamps[c.to];
+    _heap.push(c);
+}
+
+void Simplifier::collapse(uint32_t from, uint32_t to)
+{
+    _quadrics[to].add(_quadrics[from]);
+    _removed[from] = 1;
+    for (uint32_t f : _vertex_faces[from])
+    {
+        if (!alive(f)) continue;
+        Eigen::Vector3i& face = _faces[f];
+        if (face[0] == (int)to || face[1] == (int)to || face[2] == (int)to)
+        {
+            face = Eigen::Vector3i(-1, -1, -1);
+            continue;
+        }
+        for (int k = 0; k < 3; k++)
+            if (face[k] == (int)from) face[k] = (int)to;
+        _vertex_faces[to].push_back(f);
+    }
+    _vertex_faces[from].clear();
+
+    // drop dead faces from the target's list while gathering its neighbours
+    std::vector<uint32_t>& list = _vertex_faces[to];
+    list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t f) { return !alive(f); }), list.end());
+    _stamps[to]++;
+    std::vector<uint32_t> neighbours;
+    for (uint32_t f : list)
+        for (int k = 0; k < 3; k++)
+            if (_faces[f][k] != (int)to) neighbours.push_back(_faces[f][k]);
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    for (uint32_t n : neighbours) push(to, n);
+}
+
+std::vector<Eigen::Vector3i> Simplifier::run(double* error)
+{
+    const size_t vertex_count = _points.size();
+    _quadrics.assign(vertex_count, Quadric());
+    _vertex_faces.assign(vertex_count, std::vector<uint32_t>());
+    _stamps.assign(vertex_count, 0);
+    _locked.assign(vertex_count, 0);
+    _removed.assign(vertex_count, 0);
+
+    // area weighted face planes
+    std::unordered_map<uint64_t, int> edge_faces;
+    for (uint32_t f = 0; f < _faces.size(); f++)
+    {
+        const Eigen::Vector3i& face = _faces[f];
+        Eigen::Vector3d n = (_points[face[1]] - _points[face[0]]).cross(_points[face[2]] - _points[face[0]]);
+        double area = n.norm() * 0.5;
+        if (area > 0) n /= area * 2;
+        double d = -n.dot(_points[face[0]]);
+        for (int k = 0; k < 3; k++)
+        {
+            _quadrics[face[k]].addPlane(n, d, area);
+            _vertex_faces[face[k]].push_back(f);
+            uint32_t a = face[k], b = face[(k + 1) % 3];
+            edge_faces[(uint64_t)std::min(a, b) << 32 | std::max(a, b)]++;
+        }
+    }
+
+    // open borders get planes through the edge, perpendicular to the face
+    for (uint32_t f = 0; f < _faces.size(); f++)
+    {
+        const Eigen::Vector3i& face = _faces[f];
+        Eigen::Vector3d n = (_points[face[1]] - _points[face[0]]).cross(_points[face[2]] - _points[face[0]]);
+        if (n.norm() == 0) continue;
+        n.normalize();
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t a = face[k], b = face[(k + 1) % 3];
+            if (edge_faces[(uint64_t)std::min(a, b) << 32 | std::max(a, b)] != 1) continue;
+            if (_options.lock_border)
+            {
+                _locked[a] = _locked[b] = 1;
+                continue;
+            }
+            Eigen::Vector3d edge = _points[b] - _points[a];
+            Eigen::Vector3d side = edge.cross(n);
+            if (side.norm() == 0) continue;
+            side.normalize();
+            double weight = edge.squaredNorm() * kBorderWeight;
+            _quadrics[a].addPlane(side, -side.dot(_points[a]), weight);
+            _quadrics[b].addPlane(side, -side.dot(_points[b]), weight);
+        }
+    }
+
+    for (const auto& edge : edge_faces)
+        push((uint32_t)(edge.first >> 32), (uint32_t)(edge.first & 0xffffffffu));
+
+    size_t alive_faces = _faces.size();
+    const size_t target = (size_t)std::ceil(_faces.size() * std::min(1.0, std::max(0.0, _options.target_ratio)));
+    const double max_cost = _options.max_error * _options.max_error;
+    double taken = 0;
+    while (alive_faces > target && !_heap.empty())
+    {
+        Collapse c = _heap.top();
+        _heap.pop();
+        if (_removed[c.from] || _removed[c.to] || c.stamp_from != _stamps[c.from] || c.stamp_to != _stamps[c.to])
+            continue;
+        if (c.cost > max_cost) break;
+        if (!linked(c.from, c.to) || flips(c.from, c.to)) continue;
+
+        size_t shared = 0;
+        for (uint32_t f : _vertex_faces[c.from])
+            if (alive(f) && (_faces[f][0] == (int)c.to || _faces[f][1] == (int)c.to || _faces[f][2] == (int)c.to)) shared++;
+        collapse(c.from, c.to);
+        alive_faces -= shared;
+        taken = std::max(taken, c.cost);
+    }
+
+    std::vector<Eigen::Vector3i> result;
+    result.reserve(alive_faces);
+    for (uint32_t f = 0; f < _faces.size(); f++)
+        if (alive(f)) result.push_back(_faces[f]);
+    if (error) *error = std::sqrt(taken);
+    return result;
+}
+
+}
+
+std::vector<Eigen::Vector3i> CGE_UTIL::simplifyFaces(const std::vector<Eigen::Vector3d>& points, const std::vector<Eigen::Vector3i>& faces,
+    const SimplifyOptions& options, double* error)
+{
+    Simplifier simplifier(points, faces, options);
+    return simplifier.run(error);
+}
+
+std::vector<Eigen::Vector3i> CGE_UTIL::simplifyMesh(const IndexedTriangleMesh& mesh, const SimplifyOptions& options, double* error)
+{
+    return simplifyFaces(mesh.points(), mesh.faces(), options, error);
+}
+
+MeshLodChain CGE_UTIL::buildLodChain(const IndexedTriangleMesh& mesh, const std::vector<double>& ratios, SimplifyOptions options)
+{
+    MeshLodChain chain;
+    MeshLod full;
+    full.faces = mesh.faces();
+    full.error = 0;
+    chain.levels.push_back(full);
+
+    const double total = (double)mesh.faces().size();
+    for (double ratio : ratios)
+    {
+        const MeshLod& previous = chain.levels.back();
+        if (previous.faces.empty()) break;
+        // ratios are of the full mesh, each pass continues from the last level
+        options.target_ratio = ratio * total / previous.faces.size();
+        if (options.target_ratio >= 1.0) continue;
+        MeshLod lod;
+        double error = 0;
+        lod.faces = simplifyFaces(mesh.points(), previous.faces, options, &error);
+        // errors add up over the passes, an upper bound is what the selector needs
+        lod.error = previous.error + error;
+        if (lod.faces.size() >= previous.faces.size()) break;
+        chain.levels.push_back(lod);
+    }
+    return chain;
+}
+
+LodSelector::LodSelector(double pixel_threshold, double hysteresis):
+    _threshold(pixel_threshold),
+    _hysteresis(hysteresis),
+    _pixels_per_unit(720.0 / (2.0 * std::tan(30.0 * 3.14159265358979 / 180.0)))
+{
+}
+
+void LodSelector::setProjection(double viewport_height, double fov_y)
+{
+    _pixels_per_unit = viewport_height / (2.0 * std::tan(fov_y * 0.5));
+}
+
+double LodSelector::screenError(double error, double distance) const
+{
+    return error * _pixels_per_unit / std::max(distance, 1e-6);
+}
+
+int LodSelector::select(const MeshLodChain& chain, double distance, int current) const
+{
+    int levels = (int)chain.levels.size();
+    for (int i = levels - 1; i > 0; i--)
+    {
+        // only a clear margin justifies dropping detail
+        double threshold = i > current && current >= 0 ? _threshold * (1.0 - _hysteresis) : _threshold;
+        if (screenError(chain.levels[i].error, distance) <= threshold) return i;
+    }
+    return 0;
+}
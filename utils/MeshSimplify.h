@@ -0,0 +1,77 @@
+#ifndef _CGE_MESH_SIMPLIFY_H_
+#define _CGE_MESH_SIMPLIFY_H_
+
+#include <cstddef>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "utils/geometry.h"
+
+namespace CGE_UTIL
+{
+
+struct SimplifyOptions
+{
+    double target_ratio;        // fraction of the triangles to keep
+    double max_error;           // object space distance, collapses beyond it are not taken
+    bool lock_border;           // open borders keep their vertices
+    // optional per-vertex attributes (normals, uvs, ...), a collapse costs
+    // attribute_weight times the squared attribute distance on top of the geometric error
+    const float* attributes;
+    size_t attribute_stride;    // floats per vertex
+    double attribute_weight;
+
+    SimplifyOptions(): target_ratio(0.5), max_error(1e30), lock_border(false),
+        attributes(nullptr), attribute_stride(0), attribute_weight(1.0) {}
+};
+
+struct MeshLod
+{
+    std::vector<Eigen::Vector3i> faces;     // indices into the original points
+    double error;                           // object space, 0 for the full mesh
+};
+
+// Level 0 is the full mesh, every level indexes the same vertices, so the
+// chain uploads one vertex buffer and one index buffer per level.
+struct MeshLodChain
+{
+    std::vector<MeshLod> levels;
+};
+
+// Quadric error metric simplification by half-edge collapses: a vertex is
+// merged into a neighbour, so the result is a subset of the original vertices
+// and their attributes stay exact. Collapses that flip a face are rejected.
+// Returns the remaining faces; error gets the largest error taken.
+std::vector<Eigen::Vector3i> simplifyMesh(const IndexedTriangleMesh& mesh, const SimplifyOptions& options, double* error = nullptr);
+// same, continuing from a subset of the faces
+std::vector<Eigen::Vector3i> simplifyFaces(const std::vector<Eigen::Vector3d>& points, const std::vector<Eigen::Vector3i>& faces,
+    const SimplifyOptions& options, double* error = nullptr);
+
+// one level per ratio of the original triangle count, each simplified from the
+// previous one; stops early once max_error keeps a level from shrinking
+MeshLodChain buildLodChain(const IndexedTriangleMesh& mesh, const std::vector<double>& ratios, SimplifyOptions options = SimplifyOptions());
+
+// Picks the coarsest level whose projected error stays under a pixel threshold.
+// Going coarser needs the error to be a margin below the threshold, so objects
+// near a switching distance do not flicker between levels.
+class LodSelector
+{
+public:
+    explicit LodSelector(double pixel_threshold = 1.0, double hysteresis = 0.25);
+
+    // pixels per object space unit at distance 1
+    void setProjection(double viewport_height, double fov_y);
+    double screenError(double error, double distance) const;
+
+    // distance from the camera to the object's bounds, current is the level used last frame or -1
+    int select(const MeshLodChain& chain, double distance, int current = -1) const;
+
+private:
+    double _threshold;
+    double _hysteresis;
+    double _pixels_per_unit;
+};
+
+}
+
+#endif
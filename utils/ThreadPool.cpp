@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "utils/ThreadPool.h"
+
+using namespace CGE_UTIL;
+
+static thread_local bool t_in_pool = false;
+
+ThreadPool::ThreadPool(int workers, std::function<void(unsigned)> on_start):
+    _on_start(on_start),
+    _job(nullptr),
+    _generation(0),
+    _quit(false)
+{
+    if (workers < 0)
+        workers = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+    for (int i = 0; i < workers; i++)
+        _workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (std::thread& worker : _workers) worker.join();
+}
+
+void ThreadPool::runChunks(Job& job)
+{
+    size_t chunk;
+    while ((chunk = job.next.fetch_add(1)) < job.chunks)
+    {
+        size_t begin = chunk * job.grain;
+        (*job.fn)(begin, std::min(begin + job.grain, job.count));
+        if (job.done.fetch_add(1) + 1 == job.chunks)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index)
+{
+    t_in_pool = true;
+    if (_on_start) _on_start(index);
+    uint64_t seen = 0;
+    while (true)
+    {
+        Job* job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _quit || (_job && _generation != seen); });
+            if (_quit) return;
+            seen = _generation;
+            job = _job;
+            job->active++;
+        }
+        runChunks(*job);
+        {
+            // the job lives on the submitting thread's stack, let it go
+            std::lock_guard<std::mutex> lock(_mutex);
+            job->active--;
+        }
+        _finished.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn)
+{
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (count + grain - 1) / grain;
+    if (_workers.empty() || chunks == 1 || t_in_pool)
+    {
+        for (size_t begin = 0; begin < count; begin += grain)
+            fn(begin, std::min(begin + grain, count));
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(_submit);
+    Job job;
+    job.fn = &fn;
+    job.count = count;
+    job.grain = grain;
+    job.chunks = chunks;
+    job.next = 0;
+    job.done = 0;
+    job.active = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &job;
+        _generation++;
+    }
+    _wake.notify_all();
+
+    t_in_pool = true;
+    runChunks(job);
+    t_in_pool = false;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished.wait(lock, [&] { return job.done.load() == job.chunks && job.active == 0; });
+    _job = nullptr;
+}
@@ -0,0 +1,58 @@
+#ifndef _CGE_THREAD_POOL_H_
+#define _CGE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CGE_UTIL
+{
+
+// Fixed set of worker threads for data-parallel loops. The calling thread takes
+// part in every loop, so a pool of size() == 1 runs everything inline.
+class ThreadPool
+{
+public:
+    // workers < 0 starts one worker per hardware thread besides the caller
+    explicit ThreadPool(int workers = -1, std::function<void(unsigned)> on_start = nullptr);
+    ~ThreadPool();
+
+    // workers plus the calling thread
+    unsigned size() const { return (unsigned)_workers.size() + 1; }
+
+    // calls fn(begin, end) over [0, count) in chunks of at most grain items and
+    // returns once all chunks are done. Nested calls from inside a chunk run inline.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    struct Job
+    {
+        const std::function<void(size_t, size_t)>* fn;
+        size_t count, grain, chunks;
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+        int active;             // workers holding a pointer to the job, guarded by _mutex
+    };
+
+    void workerLoop(unsigned index);
+    void runChunks(Job& job);
+
+    std::vector<std::thread> _workers;
+    std::function<void(unsigned)> _on_start;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _finished;
+    std::mutex _submit;         // one loop at a time
+    Job* _job;
+    uint64_t _generation;
+    bool _quit;
+};
+
+}
+
+#endif
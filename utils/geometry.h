@@ -14,7 +14,7 @@ struct Line
     float color[4];
     float lineWidth;
     
-    Line(Eigen::Vector3d start, Eigen::Vector3d end): a(start), b(end){}
+    Line(Eigen::Vector3d start, Eigen::Vector3d end): a(start), b(end), color{1, 1, 1, 1}, lineWidth(1) {}
 };
 
 struct triangle
@@ -24,7 +24,7 @@ struct triangle
     Eigen::Vector3d c;
     float color[4];
 
-    triangle(Eigen::Vector3d a, Eigen::Vector3d b, Eigen::Vector3d c):a(a), b(b), c(c){}
+    triangle(Eigen::Vector3d a, Eigen::Vector3d b, Eigen::Vector3d c):a(a), b(b), c(c), color{1, 1, 1, 1} {}
 };
 
 class IndexedTriangleMesh
@@ -32,6 +32,10 @@ class IndexedTriangleMesh
     public:
         IndexedTriangleMesh(std::vector<Eigen::Vector3d> points, std::vector<Eigen::Vector3i> faces): _points(points), _faces(faces) {}
         
+        const std::vector<Eigen::Vector3d>& points() const { return _points; }
+        // deforming meshes move points in place, then refit their BVH
+        std::vector<Eigen::Vector3d>& points() { return _points; }
+        const std::vector<Eigen::Vector3i>& faces() const { return _faces; }
 
     
     private:
@@ -40,7 +44,7 @@ class IndexedTriangleMesh
 
 
 
-}
+};
 
 }
 